@@ -0,0 +1,177 @@
+/*
+ * XPacket
+ * Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file bench.c
+ * \brief Micro-benchmark of the generated functions.
+ *
+ *    It measures ns/packet and GB/s (of serialized data) of serialize,
+ *    deserialize and the batch functions, for some representative packets,
+ *    against a memcpy of the same number of bytes. For comparing the
+ *    optimization levels (or the options of xpacket.h, given with -D):
+ *    \code{.sh}
+ *    for o in -O2 -O3 -Os; do
+ *      cc -std=c99 $o -I.. bench.c -o bench && ./bench
+ *    done
+ *    \endcode
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+/* packets */
+#define XPACKET_C
+/* all scalar fields */
+#define XPACKET_NAME scalar
+#define XPACKET_STRUCT \
+  FIELD(uint32_t, id) \
+  FIELD(uint16_t, type) \
+  FIELD(uint8_t, flags) \
+  FIELD(uint8_t, ttl) \
+  FIELD(uint32_t, seq) \
+  FIELD(uint32_t, ack) \
+  FIELD(uint16_t, window) \
+  FIELD(uint16_t, checksum)
+#include "xpacket.h"
+#undef XPACKET_NAME
+#undef XPACKET_STRUCT
+/* a large array */
+#define XPACKET_NAME array
+#define XPACKET_STRUCT \
+  FIELD(uint16_t, len) \
+  FIELD(uint32_t, samples, 1024)
+#include "xpacket.h"
+#undef XPACKET_NAME
+#undef XPACKET_STRUCT
+/* pointers and custom fields */
+typedef uint32_t stamp_t;
+static void ser_stamp(uint8_t* pl, const stamp_t* v, XPACKET_SIZE_TYPE* idx) {
+  xpacket_put_be_uint32_t(pl, *v);
+  *idx += 4;
+}
+static void de_stamp(const uint8_t* pl, stamp_t* v, XPACKET_SIZE_TYPE* idx) {
+  *v = xpacket_get_be_uint32_t(pl);
+  *idx += 4;
+}
+#define XPACKET_NAME mixed
+#define XPACKET_STRUCT \
+  FIELD(uint16_t, id) \
+  FIELD_PTR(uint32_t, value) \
+  FIELD_PTR(uint8_t, data, 64) \
+  FIELD_CUSTOM(stamp_t, stamp, ser_stamp, de_stamp) \
+  FIELD(uint8_t, crc)
+#include "xpacket.h"
+#undef XPACKET_NAME
+#undef XPACKET_STRUCT
+
+/*---------------------------------------------------------------------------*/
+/* measurement */
+#define BATCH 256                 /* packets per batch */
+#define BYTES (BATCH * 4200)      /* enough for every batch */
+#define ROUNDS 1000               /* batches per measurement */
+static uint8_t payload[BYTES];
+static uint8_t copy[BYTES];
+/* a volatile sink keeps the compiler from removing the computation */
+static volatile uint32_t sink;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char* name, const char* fn, double t, size_t bytes) {
+  double n = (double)ROUNDS * BATCH;
+  printf("%-8s %-18s %9.2f ns/packet %8.2f GB/s\n",
+    name, fn, t * 1e9 / n, bytes * (double)ROUNDS / t * 1e-9);
+}
+
+/* measure the functions of a packet (every one on BATCH structures) */
+#define BENCH(name, field, ...) { \
+  static struct name in[BATCH], out[BATCH]; \
+  size_t bytes = 0; \
+  double t; \
+  int r, i; \
+  for (i = 0; i < BATCH; i++) { __VA_ARGS__ } \
+  t = now(); \
+  for (r = 0; r < ROUNDS; r++) { \
+    size_t off = 0; \
+    for (i = 0; i < BATCH; i++) \
+      off += serialize_##name(payload + off, in + i); \
+    bytes = off; \
+    sink += payload[r % off]; \
+  } \
+  report(#name, "serialize", now() - t, bytes); \
+  t = now(); \
+  for (r = 0; r < ROUNDS; r++) { \
+    size_t off = 0; \
+    for (i = 0; i < BATCH; i++) \
+      off += deserialize_##name(payload + off, out + i); \
+    sink += out[r % BATCH].field; \
+  } \
+  report(#name, "deserialize", now() - t, bytes); \
+  BENCH_BATCH(name, field) \
+  t = now(); \
+  for (r = 0; r < ROUNDS; r++) { \
+    memcpy(copy, payload, bytes); \
+    sink += copy[r % bytes]; \
+  } \
+  report(#name, "memcpy", now() - t, bytes); \
+}
+/* batch functions (only for the fixed layouts) */
+#define BENCH_BATCH(name, field) \
+  t = now(); \
+  for (r = 0; r < ROUNDS; r++) { \
+    serialize_batch_##name(payload, in, BATCH); \
+    sink += payload[r % bytes]; \
+  } \
+  report(#name, "serialize_batch", now() - t, bytes); \
+  t = now(); \
+  for (r = 0; r < ROUNDS; r++) { \
+    deserialize_batch_##name(payload, out, BATCH); \
+    sink += out[r % BATCH].field; \
+  } \
+  report(#name, "deserialize_batch", now() - t, bytes);
+
+int main(void) {
+  static uint32_t values[BATCH], values_out[BATCH];
+  static uint8_t data[BATCH][64], data_out[BATCH][64];
+  BENCH(scalar, id,
+    in[i].id = i; in[i].type = 2; in[i].flags = 1; in[i].ttl = 64;
+    in[i].seq = 1000 + i; in[i].ack = 2000 + i; in[i].window = 512;
+    in[i].checksum = 0xbeef;
+  )
+  BENCH(array, len,
+    int j;
+    in[i].len = 1024;
+    for (j = 0; j < 1024; j++) in[i].samples[j] = i * j;
+  )
+  #undef BENCH_BATCH
+  #define BENCH_BATCH(name, field)
+  BENCH(mixed, id,
+    values[i] = i; memset(data[i], i, 64);
+    in[i].id = i; in[i].value = values + i; in[i].data = data[i];
+    in[i].stamp = 3 * i; in[i].crc = 7;
+    out[i].value = values_out + i; out[i].data = data_out[i];
+  )
+  return 0;
+}
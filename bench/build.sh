@@ -0,0 +1,96 @@
+#!/usr/bin/env bash
+#
+# XPacket
+# Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Build-time benchmark of a large schema, against a previous xpacket.h.
+#
+# It generates a header of N packets (12 fields each, and a FIELD_CUSTOM
+# every 3 packets, so only the kinds of the first version are used), that
+# only declares them in K translation units, while a single unit defines
+# XPACKET_C and generates all the functions (as the README describes).
+# The same files are built with the current xpacket.h and with the one of
+# the commit BASE (by default the first one, before all the options), and
+# the time of the declaring units and of the defining one is printed; the
+# compiler and the options are given by CC and CFLAGS:
+#   CC=gcc CFLAGS=-O2 BASE=HEAD~1 ./build.sh 60 64
+# With gcc 12 -O2, 60 packets and 64 units, the declarations take 11.2 s
+# instead of 1.8 s (2.9 ms per packet and unit instead of 0.5 ms, mostly
+# preprocessing the probes, the layout enumerators, the views and the
+# checks generated at every inclusion), and the definitions 4.0 s instead
+# of 2.2 s; on a loaded machine the times vary, but the ratios do not.
+
+set -e
+N=${1:-60}
+K=${2:-64}
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:--O2}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BASE=${BASE:-$(git -C "$ROOT" rev-list --max-parents=0 HEAD)}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+mkdir "$DIR/base"
+git -C "$ROOT" show "$BASE:xpacket.h" > "$DIR/base/xpacket.h"
+
+# packets
+TYPES=(uint8_t uint16_t uint32_t)
+{
+  printf '#ifndef PACKETS_H\n#define PACKETS_H\n#include <stdint.h>\n'
+  printf 'static inline void ser_c(uint8_t* pl, const uint32_t* v,'
+  printf ' uint16_t* idx) {\n  pl[0] = (uint8_t)*v;\n  *idx += 1;\n}\n'
+  printf 'static inline void de_c(const uint8_t* pl, uint32_t* v,'
+  printf ' uint16_t* idx) {\n  *v = pl[0];\n  *idx += 1;\n}\n'
+  for ((p = 0; p < N; p++)); do
+    printf '#define XPACKET_NAME p%d\n#define XPACKET_STRUCT' $p
+    for ((f = 0; f < 12; f++)); do
+      t=${TYPES[$(((p + f) % 3))]}
+      if ((f % 5 == 4)); then printf ' FIELD(%s, f%d, 8)' $t $f
+      else printf ' FIELD(%s, f%d)' $t $f; fi
+    done
+    if ((p % 3 == 2)); then
+      printf ' FIELD_CUSTOM(uint32_t, c, ser_c, de_c)'
+    fi
+    printf '\n#include "xpacket.h"\n'
+    printf '#undef XPACKET_NAME\n#undef XPACKET_STRUCT\n'
+  done
+  printf '#endif\n'
+} > "$DIR/packets.h"
+
+# translation units using the first packet, and the one defining them all
+for ((k = 0; k < K; k++)); do
+  {
+    printf '#include "packets.h"\n'
+    printf 'int use%d(uint8_t* pl, const struct p0* m) {\n' $k
+    printf '  return serialize_p0(pl, m);\n}\n'
+  } > "$DIR/use$k.c"
+done
+printf '#define XPACKET_C\n#include "packets.h"\n' > "$DIR/packets.c"
+
+# build the given units with the xpacket.h in $INC, and print the time
+build() {
+  local start=$(date +%s%N) f
+  for f in "$@"; do
+    $CC -std=c99 $CFLAGS -I"$DIR" -I"$INC" -c "$DIR/$f" -o "$DIR/${f%.c}.o"
+  done
+  echo "$(( ($(date +%s%N) - start) / 1000000 )) ms"
+}
+UNITS=$(cd "$DIR" && ls use?*.c)
+echo "$N packets, $K units ($CC $CFLAGS)"
+for INC in "$DIR/base" "$ROOT"; do
+  if [ "$INC" = "$ROOT" ]; then echo "current:"; else echo "$BASE:"; fi
+  echo "  declarations ($K units): $(build $UNITS)"
+  echo "  definitions (1 unit):    $(build packets.c)"
+done
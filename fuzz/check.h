@@ -0,0 +1,544 @@
+/*
+ * XPacket
+ * Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file check.h
+ * \brief Differential checks of a packet (extension of xpacket.h).
+ * \author Matteo Parolari <mparolari.dev@gmail.com>
+ * \copyright GNU Lesser General Public License version 3.
+ * \version 0.3
+ * \date 02/2018
+ *
+ *    Included by xpacket.h (as XPACKET_EXTENSION) after the functions of
+ *    every packet msg, it generates:
+ *    \code{.c}
+ *    static void msg_check(void);
+ *    static void msg_fuzz(const uint8_t* data, size_t size);
+ *    \endcode
+ *    that compare the functions of msg with the reference encoder of
+ *    spec.h, written from the description of the payload only:
+ *    msg_check on a random structure (every function, on every payload
+ *    length, and the views, the column readers, the dispatch, the ring
+ *    and the log), and msg_fuzz on any payload (the bounds-checked
+ *    deserialization, that must fail or succeed in the same way; it does
+ *    nothing if the packet has FIELD_CUSTOM fields). Every difference
+ *    calls harness_fail (see harness.c).
+ */
+
+/* names of the functions under test, the reference ones and the checks */
+#define OPT(fn) METHOD(fn, XPACKET_NAME)
+#define SPEC(fn) CONSTANT(XPACKET_NAME, spec_##fn)
+#define LOCAL(name) CONSTANT(XPACKET_NAME, name)
+#define FAIL_IF(cond) \
+  if (cond) harness_fail(LOCAL(name), __FILE__, __LINE__)
+
+static const char LOCAL(name)[] = HARNESS_STRING(XPACKET_NAME);
+
+#include "spec.h"
+
+/* targets of the FIELD_PTR fields (and a member, if there are none) */
+struct LOCAL(targets) {
+  #define FIELD_VAR(type, name)
+  #define FIELD_ARRAY(type, name, dim)
+  #define FIELD_PTR_VAR(type, name)         type name;
+  #define FIELD_PTR_ARRAY(type, name, dim)  type name[dim];
+  #define FIELD_VARRAY(type, name, maxdim, lenfield)
+  #define FIELD_VARINT(type, name)
+  #define FIELD_BITS(type, name, nbits)
+  #define FIELD_CUSTOM(type, name, ser, de)
+  #define FIELD_HOOK(type, name, ser, de)
+  XPACKET_STRUCT
+  uint8_t unused;
+  #undef FIELD_PTR_VAR
+  #undef FIELD_PTR_ARRAY
+};
+
+/* point the FIELD_PTR fields to the targets */
+#define FIELD_PTR_VAR(type, name)         _m->name = &_t->name;
+#define FIELD_PTR_ARRAY(type, name, dim)  _m->name = _t->name;
+#if !defined(XPACKET_CUSTOM_FIELDS) || !defined(HARNESS_FUZZER)
+static void LOCAL(point)(struct XPACKET_NAME* _m, struct LOCAL(targets)* _t) {
+  XPACKET_STRUCT
+  (void)_m;
+  (void)_t;
+}
+#endif
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+
+/* randomize the fields (every one with probability change/4) */
+#define CHANGE (harness_random() % 4 < _change)
+#define FIELD_VAR(type, name) \
+  if (CHANGE) harness_bytes(&_m->name, sizeof(type));
+#define FIELD_ARRAY(type, name, dim) \
+  if (CHANGE) harness_bytes(_m->name, sizeof(_m->name));
+#define FIELD_PTR_VAR(type, name) \
+  if (CHANGE) harness_bytes(_m->name, sizeof(type));
+#define FIELD_PTR_ARRAY(type, name, dim) \
+  if (CHANGE) harness_bytes(_m->name, sizeof(type) * (dim));
+#define FIELD_VARRAY(type, name, maxdim, lenfield) \
+  if (CHANGE) { \
+    _m->lenfield = harness_random() % 4 ? \
+      harness_random() % ((maxdim) + 1) : (maxdim); \
+    harness_bytes(_m->name, sizeof(_m->name)); \
+  } \
+  if (_m->lenfield > (maxdim)) _m->lenfield = (maxdim);
+#define FIELD_VARINT(type, name) \
+  if (CHANGE) harness_bytes(&_m->name, sizeof(type));
+#define FIELD_BITS(type, name, nbits) \
+  if (CHANGE) _m->name = (type)(harness_random() >> (32 - (nbits)));
+#define FIELD_CUSTOM(type, name, ser, de) \
+  if (CHANGE) harness_bytes(&_m->name, sizeof(type));
+#define FIELD_HOOK(type, name, ser, de) \
+  if (CHANGE) harness_bytes(&_m->name, sizeof(type));
+#ifndef HARNESS_FUZZER
+static void LOCAL(fill)(struct XPACKET_NAME* _m, unsigned _change) {
+  XPACKET_STRUCT
+}
+#endif
+#undef CHANGE
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+
+#if defined(XPACKET_DELTA) && !defined(HARNESS_FUZZER)
+/* copy a structure (and its targets, but not the pointers to them) */
+static void LOCAL(copy)(struct XPACKET_NAME* _dst,
+    struct LOCAL(targets)* _dt, const struct XPACKET_NAME* _src,
+    const struct LOCAL(targets)* _st) {
+  memcpy(_dst, _src, sizeof(*_dst));
+  memcpy(_dt, _st, sizeof(*_dt));
+  LOCAL(point)(_dst, _dt);
+}
+#endif
+
+/* serialize a structure with the two implementations: the same bytes */
+/* (left in harness_pl[2]) */
+#if !defined(XPACKET_CUSTOM_FIELDS) || !defined(HARNESS_FUZZER)
+static XPACKET_SIZE_TYPE LOCAL(same)(const struct XPACKET_NAME* _m) {
+  XPACKET_SIZE_TYPE n = OPT(serialize)(harness_pl[2], _m);
+  FAIL_IF(SPEC(write)(harness_pl[3], _m, NULL) != n);
+  FAIL_IF(memcmp(harness_pl[2], harness_pl[3], n));
+  return n;
+}
+#endif
+
+/**
+ * \brief        Deserialize any payload, with the two implementations.
+ * \param data   Payload memory address.
+ * \param size   Payload length.
+ *
+ *    The bounds-checked deserializations must return the same number of
+ *    bytes, and if they succeed the structures must be serialized again
+ *    in the same bytes.
+ */
+static void LOCAL(fuzz)(const uint8_t* data, size_t size) {
+  #ifndef XPACKET_CUSTOM_FIELDS
+  struct XPACKET_NAME m, r;
+  struct LOCAL(targets) tm, tr;
+  XPACKET_SIZE_TYPE len = size < HARNESS_MAX ? (XPACKET_SIZE_TYPE)size :
+    (XPACKET_SIZE_TYPE)HARNESS_MAX;
+  XPACKET_SIZE_TYPE n;
+  #ifdef XPACKET_ARENA
+  struct xpacket_arena arena;
+  #endif
+  LOCAL(point)(&m, &tm);
+  LOCAL(point)(&r, &tr);
+  n = OPT(deserialize_n)(data, len, &m);
+  FAIL_IF(SPEC(read)(data, len, &r) != n);
+  if (n > 0) {
+    n = LOCAL(same)(&m);
+    FAIL_IF(SPEC(write)(harness_pl[3], &r, NULL) != n);
+    FAIL_IF(memcmp(harness_pl[2], harness_pl[3], n));
+  }
+  #ifdef XPACKET_ARENA
+  arena.base = harness_arena;
+  arena.used = 0;
+  arena.cap = sizeof(harness_arena);
+  n = OPT(deserialize_arena)(data, len, &m, &arena);
+  FAIL_IF(SPEC(read)(data, len, &r) != n);
+  if (n > 0) {
+    n = LOCAL(same)(&m);
+    FAIL_IF(SPEC(write)(harness_pl[3], &r, NULL) != n);
+    FAIL_IF(memcmp(harness_pl[2], harness_pl[3], n));
+  }
+  #endif
+  #else
+  (void)data;
+  (void)size;
+  #endif
+}
+
+#ifndef HARNESS_FUZZER
+/* views of the fields before the first variable one: the offsets must */
+/* be the ones of the payload, walking it from its beginning (_b counts */
+/* the bits), the getters must read the structure from the payload, and */
+/* the setters must write it in any bytes (_q, complemented) */
+#define FIELD_VAR(type, name) \
+  _b = (_b + 7) / 8 * 8; \
+  FAIL_IF((size_t)CONSTANT(XPACKET_NAME, OFF_##name) != _b / 8); \
+  { \
+    type _v = ACCESSOR(get, name)(_pl); \
+    FAIL_IF(memcmp(&_v, &_m->name, sizeof(type))); \
+    ACCESSOR(set, name)(_q, _m->name); \
+  } \
+  _b += 8 * sizeof(type);
+#define FIELD_ARRAY(type, name, dim) \
+  _b = (_b + 7) / 8 * 8; \
+  FAIL_IF((size_t)CONSTANT(XPACKET_NAME, OFF_##name) != _b / 8); \
+  for (_i = 0; _i < (dim); _i++) { \
+    type _v = ACCESSOR(get, name)(_pl, (XPACKET_SIZE_TYPE)_i); \
+    FAIL_IF(memcmp(&_v, &_m->name[_i], sizeof(type))); \
+    ACCESSOR(set, name)(_q, (XPACKET_SIZE_TYPE)_i, _m->name[_i]); \
+  } \
+  _b += 8 * sizeof(type) * (dim);
+#define FIELD_PTR_VAR(type, name) \
+  _b = (_b + 7) / 8 * 8; \
+  FAIL_IF((size_t)CONSTANT(XPACKET_NAME, OFF_##name) != _b / 8); \
+  { \
+    type _v = ACCESSOR(get, name)(_pl); \
+    FAIL_IF(memcmp(&_v, _m->name, sizeof(type))); \
+    ACCESSOR(set, name)(_q, *_m->name); \
+  } \
+  _b += 8 * sizeof(type);
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+#define FIELD_VARRAY                      FIXED_PREFIX_END
+#define FIELD_VARINT                      FIXED_PREFIX_END
+#define FIELD_BITS(type, name, nbits) \
+  FAIL_IF((size_t)CONSTANT(XPACKET_NAME, BIT_##name) != _b); \
+  FAIL_IF((size_t)CONSTANT(XPACKET_NAME, OFF_##name) != _b / 8); \
+  FAIL_IF(ACCESSOR(get, name)(_pl) != _m->name); \
+  ACCESSOR(set, name)(_q, _m->name); \
+  _b += (nbits);
+#define FIELD_CUSTOM                      FIXED_PREFIX_END
+#define FIELD_HOOK                        FIXED_PREFIX_END
+static void LOCAL(views)(const struct XPACKET_NAME* _m, const uint8_t* _pl,
+    XPACKET_SIZE_TYPE _n) {
+  uint8_t* _q = harness_pl[1];
+  size_t _b = 0, _i;
+  #ifdef XPACKET_SCHEMA_PREFIX
+  _b = 32;
+  #endif
+  for (_i = 0; _i < _n; _i++) _q[_i] = (uint8_t)~_pl[_i];
+  (void)_m; /* unused if the first field is variable */
+  FIXED_PREFIX
+  /* the bytes of the whole fields are the payload ones, and the bits of */
+  /* the bit fields (while the unused bits after them are preserved) */
+  #undef FIELD_VAR
+  #undef FIELD_ARRAY
+  #undef FIELD_PTR_VAR
+  #undef FIELD_BITS
+  #define PADDING \
+    if (_b % 8) \
+      FAIL_IF(harness_spec_bits(_q, _b, 8 - _b % 8) != \
+        (~harness_spec_bits(_pl, _b, 8 - _b % 8) & (0xffu >> _b % 8)));
+  #define FIELD_VAR(type, name) \
+    PADDING \
+    _b = (_b + 7) / 8 * 8; \
+    FAIL_IF(memcmp(_q + _b / 8, _pl + _b / 8, sizeof(type))); \
+    _b += 8 * sizeof(type);
+  #define FIELD_ARRAY(type, name, dim) \
+    PADDING \
+    _b = (_b + 7) / 8 * 8; \
+    FAIL_IF(memcmp(_q + _b / 8, _pl + _b / 8, sizeof(type) * (dim))); \
+    _b += 8 * sizeof(type) * (dim);
+  #define FIELD_PTR_VAR(type, name)         FIELD_VAR(type, name)
+  #define FIELD_BITS(type, name, nbits) \
+    FAIL_IF(harness_spec_bits(_q, _b, nbits) != \
+      harness_spec_bits(_pl, _b, nbits)); \
+    _b += (nbits);
+  #ifdef XPACKET_SCHEMA_PREFIX
+  _b = 32;
+  #else
+  _b = 0;
+  #endif
+  FIXED_PREFIX
+  PADDING
+  #undef PADDING
+}
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+
+#ifdef XPACKET_COLUMN_LAYOUT
+/* column readers: the values of the structures (3 of them) */
+#define FIELD_VAR(type, name) \
+  { \
+    type _c[3]; \
+    ACCESSOR(get_column, name)(_in, 3, _c); \
+    for (_i = 0; _i < 3; _i++) \
+      FAIL_IF(memcmp(&_c[_i], &_v[_i].name, sizeof(type))); \
+  }
+#define FIELD_ARRAY(type, name, dim) \
+  { \
+    type _c[3 * (dim)]; \
+    ACCESSOR(get_column, name)(_in, 3, _c); \
+    for (_i = 0; _i < 3; _i++) \
+      FAIL_IF(memcmp(_c + (dim) * _i, _v[_i].name, sizeof(type) * (dim))); \
+  }
+#define FIELD_PTR_VAR(type, name) \
+  { \
+    type _c[3]; \
+    ACCESSOR(get_column, name)(_in, 3, _c); \
+    for (_i = 0; _i < 3; _i++) \
+      FAIL_IF(memcmp(&_c[_i], _v[_i].name, sizeof(type))); \
+  }
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+static void LOCAL(columns)(const uint8_t* _in,
+    const struct XPACKET_NAME* _v) {
+  size_t _i;
+  XPACKET_STRUCT
+}
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#endif
+
+/**
+ * \brief        Check every function on a random structure.
+ */
+static void LOCAL(check)(void) {
+  struct XPACKET_NAME a, b;
+  struct LOCAL(targets) ta, tb;
+  XPACKET_SIZE_TYPE n, k;
+  uint8_t* pl = harness_pl[0];
+  LOCAL(point)(&a, &ta);
+  LOCAL(fill)(&a, 4);
+  n = LOCAL(same)(&a);
+  FAIL_IF(n > HARNESS_MAX);
+  FAIL_IF(SPEC(schema)() != (uint32_t)CONSTANT(XPACKET_NAME, SCHEMA_ID));
+  FAIL_IF(OPT(serialize)(pl, &a) != n);
+  /* the layout is fixed if the sizes are known at compile time */
+  #ifdef XPACKET_FIXED_LAYOUT
+  FAIL_IF(!SPEC(fixed) || n != CONSTANT(XPACKET_NAME, WIRE_SIZE));
+  #else
+  FAIL_IF(SPEC(fixed));
+  #endif
+  /* deserialization of the payload, serialized again in the same bytes */
+  LOCAL(point)(&b, &tb);
+  FAIL_IF(OPT(deserialize)(pl, &b) != n);
+  FAIL_IF(LOCAL(same)(&b) != n || memcmp(harness_pl[2], pl, n));
+  FAIL_IF(SPEC(read)(pl, n, &b) != n);
+  FAIL_IF(LOCAL(same)(&b) != n || memcmp(harness_pl[2], pl, n));
+  LOCAL(views)(&a, pl, n);
+  #ifndef XPACKET_CUSTOM_FIELDS
+  /* bounds-checked functions, on every capacity (or some of them) */
+  for (k = 0; k <= n; k += n <= 64 ? 1u : 1u + harness_random() % 17) {
+    FAIL_IF(OPT(serialize_n)(harness_pl[1], k, &a) != (k < n ? 0 : n));
+    FAIL_IF(OPT(deserialize_n)(pl, k, &b) != (k < n ? 0 : n));
+    LOCAL(fuzz)(pl, k);
+  }
+  FAIL_IF(OPT(serialize_n)(harness_pl[1], n, &a) != n);
+  FAIL_IF(memcmp(harness_pl[1], pl, n));
+  LOCAL(fuzz)(pl, n);
+  /* corrupted payloads (a byte incremented, decremented or random) */
+  for (k = 0; k < 12 && n > 0; k++) {
+    XPACKET_SIZE_TYPE at = (XPACKET_SIZE_TYPE)(harness_random() % n);
+    memcpy(harness_pl[1], pl, n);
+    harness_pl[1][at] = (uint8_t)(k % 3 == 0 ? pl[at] + 1u :
+      k % 3 == 1 ? pl[at] - 1u : harness_random());
+    LOCAL(fuzz)(harness_pl[1], n);
+  }
+  #endif
+  #ifdef XPACKET_ID
+  {
+    /* the frame (identifier and payload) is dispatched to the packet, */
+    /* unless it's truncated or the identifier is unknown */
+    uint8_t* frame = harness_pl[1];
+    uint8_t id = 0;
+    FAIL_IF(CONSTANT(XPACKET_NAME, FIXED_SIZE) != (SPEC(fixed) ? n : 0));
+    frame[0] = CONSTANT(XPACKET_NAME, ID);
+    memcpy(frame + 1, pl, n);
+    LOCAL(point)(&b, &tb);
+    FAIL_IF(harness_dispatch(frame, n + 1u, &id, &b) != n + 1u);
+    FAIL_IF(id != CONSTANT(XPACKET_NAME, ID));
+    FAIL_IF(LOCAL(same)(&b) != n || memcmp(harness_pl[2], pl, n));
+    FAIL_IF(harness_dispatch(frame, harness_random() % (n + 1u), &id, &b));
+    frame[0] = 255;
+    FAIL_IF(harness_dispatch(frame, n + 1u, &id, &b) || id != 255);
+  }
+  #endif
+  #ifdef XPACKET_FIXED_LAYOUT
+  {
+    /* batch and columnar functions, on a few packets */
+    struct XPACKET_NAME v[3], w[3];
+    struct LOCAL(targets) tv[3], tw[3];
+    struct CONSTANT(XPACKET_NAME, decoder) dec;
+    size_t i, j;
+    for (i = 0; i < 3; i++) {
+      LOCAL(point)(&v[i], &tv[i]);
+      LOCAL(fill)(&v[i], 4);
+      LOCAL(point)(&w[i], &tw[i]);
+      FAIL_IF(SPEC(write)(harness_pl[3] + i * n, &v[i], NULL) != n);
+    }
+    FAIL_IF(OPT(serialize_batch)(harness_pl[2], v, 3) != 3 * n);
+    FAIL_IF(memcmp(harness_pl[2], harness_pl[3], 3 * n));
+    FAIL_IF(OPT(deserialize_batch)(harness_pl[3], w, 3) != 3 * n);
+    FAIL_IF(OPT(serialize_batch)(harness_pl[1], w, 3) != 3 * n);
+    FAIL_IF(memcmp(harness_pl[1], harness_pl[3], 3 * n));
+    #ifdef XPACKET_COLUMN_LAYOUT
+    j = OPT(serialize_columns)(harness_pl[1], v, 3);
+    FAIL_IF(SPEC(columns)(harness_pl[2], v, 3) != j);
+    FAIL_IF(memcmp(harness_pl[1], harness_pl[2], j));
+    LOCAL(columns)(harness_pl[2], v);
+    FAIL_IF(OPT(deserialize_columns)(harness_pl[2], w, 3) != j);
+    FAIL_IF(OPT(serialize_columns)(harness_pl[1], w, 3) != j);
+    FAIL_IF(memcmp(harness_pl[1], harness_pl[2], j));
+    #endif
+    {
+      /* a ring of 4 slots, against a model of it: the producer reserves */
+      /* the tickets in order and commits them in any order, and the */
+      /* consumer gets the committed ones after the last released */
+      struct xpacket_ring ring;
+      size_t seq[4], pend[4], np = 0, head = 0, tail = 0, step;
+      int done[4] = { 0, 0, 0, 0 };
+      uint8_t* data;
+      FAIL_IF(!(data = (uint8_t*)malloc(4 * n)));
+      FAIL_IF(xpacket_ring_init(&ring, data, seq, 4, n) != 0);
+      for (step = 0; step < 32; step++) {
+        size_t t;
+        const uint8_t* run;
+        uint8_t* slot;
+        switch (harness_random() % 3) {
+          case 0:
+            slot = xpacket_ring_reserve(&ring, &t);
+            FAIL_IF((slot == NULL) != (head - tail == 4));
+            if (slot) {
+              FAIL_IF(t != head || slot != data + head % 4 * n);
+              FAIL_IF(OPT(serialize)(slot, &v[head % 3]) != n);
+              pend[np++] = head++;
+            }
+            break;
+          case 1:
+            if (np > 0) {
+              i = harness_random() % np;
+              xpacket_ring_commit(&ring, pend[i]);
+              done[pend[i] % 4] = 1;
+              pend[i] = pend[--np];
+            }
+            break;
+          default:
+            run = xpacket_ring_peek(&ring, &j);
+            for (i = 0; tail % 4 + i < 4 && done[(tail + i) % 4]; i++)
+              FAIL_IF(memcmp(run + i * n, harness_pl[3] +
+                (tail + i) % 3 * n, n));
+            FAIL_IF(j != i || run != data + tail % 4 * n);
+            j = harness_random() % (j + 1);
+            xpacket_ring_release(&ring, j);
+            for (i = 0; i < j; i++) done[(tail + i) % 4] = 0;
+            tail += j;
+        }
+      }
+      free(data);
+    }
+    {
+      /* a log of the batch and a packet, after an incomplete record (that */
+      /* is removed), mapped back */
+      struct xpacket_log log;
+      FAIL_IF(truncate(harness_log, (off_t)(harness_random() % n)) != 0);
+      FAIL_IF(xpacket_log_create(&log, harness_log, n) != 0);
+      FAIL_IF(log.count != 0);
+      FAIL_IF(xpacket_log_append(&log, harness_pl[3], 3) != 0);
+      FAIL_IF(xpacket_log_append(&log, pl, 1) != 0 || log.count != 4);
+      FAIL_IF(xpacket_log_close(&log) != 0);
+      FAIL_IF(xpacket_log_open(&log, harness_log, n) != 0);
+      FAIL_IF(log.count != 4);
+      FAIL_IF(memcmp(xpacket_log_at(&log, 0), harness_pl[3], 3 * n));
+      FAIL_IF(memcmp(xpacket_log_at(&log, 3), pl, n));
+      FAIL_IF(OPT(deserialize_batch)(xpacket_log_at(&log, 0), w, 3) != 3 * n);
+      FAIL_IF(xpacket_log_close(&log) != 0);
+      FAIL_IF(OPT(serialize_batch)(harness_pl[1], w, 3) != 3 * n);
+      FAIL_IF(memcmp(harness_pl[1], harness_pl[3], 3 * n));
+    }
+    /* streaming deserialization, in fragments of random length (copied */
+    /* in buffers of their size, so a sanitizer sees the over-reads) */
+    memset(&dec, 0, sizeof(dec));
+    LOCAL(point)(&b, &tb);
+    for (i = 0; i < n; i += j) {
+      uint8_t* frag;
+      j = 1 + harness_random() % n;
+      j = j < n - i ? j : n - i;
+      FAIL_IF(!(frag = (uint8_t*)malloc(j)));
+      memcpy(frag, pl + i, j);
+      j = OPT(feed)(&dec, &b, frag, j);
+      free(frag);
+    }
+    FAIL_IF(dec.pos != n);
+    FAIL_IF(OPT(serialize)(harness_pl[1], &b) != n);
+    FAIL_IF(memcmp(harness_pl[1], pl, n));
+  }
+  #endif
+  #ifdef XPACKET_IOV
+  {
+    /* the iovec entries, concatenated, are the payload */
+    struct iovec iov[CONSTANT(XPACKET_NAME, IOV_ENTRIES)];
+    uint16_t i, niov = OPT(serialize_iov)(harness_pl[1], iov, &a);
+    size_t len = 0;
+    for (i = 0; i < niov; i++) {
+      FAIL_IF(len + iov[i].iov_len > n);
+      memcpy(harness_pl[2] + len, iov[i].iov_base, iov[i].iov_len);
+      len += iov[i].iov_len;
+    }
+    FAIL_IF(len != n || memcmp(harness_pl[2], pl, n));
+  }
+  #endif
+  #ifdef XPACKET_DELTA
+  {
+    /* b changes some fields of a: the delta applied to a gives b */
+    struct LOCAL(targets) tc;
+    struct XPACKET_NAME c;
+    LOCAL(copy)(&b, &tb, &a, &ta);
+    LOCAL(fill)(&b, harness_random() % 4);
+    k = OPT(serialize_delta)(harness_pl[2], &b, &a);
+    FAIL_IF(SPEC(write)(harness_pl[3], &b, &a) != k);
+    FAIL_IF(memcmp(harness_pl[2], harness_pl[3], k));
+    LOCAL(copy)(&c, &tc, &a, &ta);
+    FAIL_IF(OPT(deserialize_delta)(harness_pl[3], &c) != k);
+    k = OPT(serialize)(harness_pl[1], &b);
+    FAIL_IF(OPT(serialize)(harness_pl[2], &c) != k);
+    FAIL_IF(memcmp(harness_pl[1], harness_pl[2], k));
+  }
+  #endif
+  (void)k; /* unused without the bounds-checked functions and the delta */
+}
+#endif
+
+#undef OPT
+#undef SPEC
+#undef LOCAL
+#undef FAIL_IF
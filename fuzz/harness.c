@@ -0,0 +1,248 @@
+/*
+ * XPacket
+ * Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file harness.c
+ * \brief Differential and fuzz harness of the optimized functions.
+ * \author Matteo Parolari <mparolari.dev@gmail.com>
+ * \copyright GNU Lesser General Public License version 3.
+ * \version 0.3
+ * \date 02/2018
+ *
+ *    The random packets of schema.h (see schema.sh) are generated with
+ *    the options under test, and for every packet check.h compares the
+ *    functions with the reference encoder of spec.h (that shares no code
+ *    with xpacket.h), on random structures and on any payload; the
+ *    packets with an identifier are also dispatched (xpacket_dispatch.h),
+ *    and the fixed ones go through a ring (xpacket_ring.h) and a log
+ *    (xpacket_log.h, in a temporary file).
+ *    \code{.sh}
+ *    ./schema.sh 42 > schema.h
+ *    cc -std=c99 -O2 -mavx2 -I. -I.. -DXPACKET_CHECKSUM \
+ *      -DXPACKET_TABLE_DRIVEN harness.c -o harness
+ *    ./harness 1000      # rounds of random checks (and a seed, optional)
+ *    ./harness -f crash  # replay of payloads (e.g. found by libFuzzer)
+ *    \endcode
+ *    With HARNESS_FUZZER defined, main is not generated and the payloads
+ *    come from libFuzzer (the first byte selects the packet):
+ *    \code{.sh}
+ *    clang -g -O1 -fsanitize=fuzzer,address,undefined -DHARNESS_FUZZER \
+ *      -I. -I.. harness.c -o fuzzer && ./fuzzer corpus/
+ *    \endcode
+ *    The script run.sh builds and runs the harness for every combination
+ *    of the options (and traits.cpp, the check of the C++ traits).
+ */
+
+/* for xpacket_log.h (-std=c99 hides the POSIX declarations) */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+/* shared by the checks of every packet */
+#define HARNESS_MAX 8192 /* maximum payload (schema.sh stays below) */
+#define HARNESS_STRING(x) HARNESS_STRING_AUX(x)
+#define HARNESS_STRING_AUX(x) #x
+
+static uint8_t harness_pl[4][3 * HARNESS_MAX]; /* payloads (and batches) */
+#ifdef XPACKET_ARENA
+static uint8_t harness_arena[HARNESS_MAX]; /* for deserialize_arena */
+#endif
+#ifndef HARNESS_FUZZER
+static uint64_t harness_state = 1; /* random generator (xorshift64*) */
+static char harness_log[] = "/tmp/xpacket-XXXXXX"; /* for xpacket_log.h */
+
+static uint32_t harness_random(void) {
+  harness_state ^= harness_state >> 12;
+  harness_state ^= harness_state << 25;
+  harness_state ^= harness_state >> 27;
+  return (uint32_t)((harness_state * 0x2545f4914f6cdd1dull) >> 32);
+}
+
+static void harness_bytes(void* dst, size_t n) {
+  uint8_t* p = (uint8_t*)dst;
+  while (n--) *p++ = (uint8_t)harness_random();
+}
+
+/* xpacket_dispatch (defined after the packets, see below) */
+static size_t harness_dispatch(const uint8_t* frame, size_t len,
+  uint8_t* id, void* data);
+#endif
+
+static void harness_fail(const char* packet, const char* file, int line) {
+  fprintf(stderr, "harness: %s differs (%s:%d)\n", packet, file, line);
+  abort();
+}
+
+/*---------------------------------------------------------------------------*/
+/* external functions of the schema (the sizes are the ones of xpacket.h) */
+#ifndef XPACKET_SIZE_TYPE
+#define XPACKET_SIZE_TYPE uint16_t
+#endif
+
+/* FIELD_CUSTOM: the number of significant bytes of a uint32_t (0 to 4), */
+/* then the bytes (most significant first) */
+static void harness_put_custom(uint8_t* pl, const uint32_t* v,
+    XPACKET_SIZE_TYPE* idx) {
+  uint8_t i, n = 0;
+  while (n < 4 && *v >> 8 * n) n++;
+  pl[0] = n;
+  for (i = 0; i < n; i++) pl[1 + i] = (uint8_t)(*v >> 8 * (n - 1 - i));
+  *idx += 1 + n;
+}
+
+static void harness_get_custom(const uint8_t* pl, uint32_t* v,
+    XPACKET_SIZE_TYPE* idx) {
+  uint8_t i, n = pl[0] < 4 ? pl[0] : 4;
+  *v = 0;
+  for (i = 0; i < n; i++) *v = *v << 8 | pl[1 + i];
+  *idx += 1 + n;
+}
+
+/* FIELD_HOOK: a tag (0 if a uint16_t fits a byte, 1 otherwise), then the */
+/* bytes (most significant first); a tag over 1 is not valid */
+static XPACKET_SIZE_TYPE harness_put_hook(uint8_t* pl, XPACKET_SIZE_TYPE len,
+    const uint16_t* v) {
+  if (len < (*v < 256 ? 2 : 3)) return 0;
+  if (*v < 256) {
+    pl[0] = 0;
+    pl[1] = (uint8_t)*v;
+    return 2;
+  }
+  pl[0] = 1;
+  pl[1] = (uint8_t)(*v >> 8);
+  pl[2] = (uint8_t)*v;
+  return 3;
+}
+
+static XPACKET_SIZE_TYPE harness_get_hook(const uint8_t* pl,
+    XPACKET_SIZE_TYPE len, uint16_t* v) {
+  if (len < 2 || pl[0] > 1 || len < 2 + pl[0]) return 0;
+  *v = pl[0] ? (uint16_t)(pl[1] << 8 | pl[2]) : pl[1];
+  return 2 + pl[0];
+}
+
+/*---------------------------------------------------------------------------*/
+/* the packets, with the checks */
+#include "xpacket_ring.h"
+#include "xpacket_log.h"
+#define XPACKET_C
+#define XPACKET_EXTENSION "check.h"
+#include "schema.h"
+
+#ifndef HARNESS_FUZZER
+/* the packets with an identifier */
+#define XPACKET_PACKETS SCHEMA_DISPATCH
+#include "xpacket_dispatch.h"
+
+static size_t harness_dispatch(const uint8_t* frame, size_t len,
+    uint8_t* id, void* data) {
+  return xpacket_dispatch(frame, (XPACKET_SIZE_TYPE)len, id, data);
+}
+
+/* the registry has every packet (in order), found by its identifier */
+static void harness_registry(void) {
+  const struct xpacket_entry* e;
+  int i, found = 0;
+  for (i = 0; i < 256; i++) {
+    e = xpacket_lookup((uint8_t)i);
+    if (!e) continue;
+    if (e->id != i) harness_fail(e->name, __FILE__, __LINE__);
+    found++;
+  }
+  if (found != XPACKET_ENTRIES) harness_fail("registry", __FILE__, __LINE__);
+  #define HARNESS_ENTRY(packet) \
+    e = &xpacket_entries[xpacket_entry_##packet]; \
+    if (xpacket_lookup(packet##_ID) != e || e->id != packet##_ID || \
+        e->wire_size != (size_t)packet##_FIXED_SIZE || \
+        e->deserialize != packet##_deserialize_any || \
+        strcmp(e->name, #packet)) \
+      harness_fail(#packet, __FILE__, __LINE__);
+  SCHEMA_DISPATCH(HARNESS_ENTRY)
+  #undef HARNESS_ENTRY
+}
+#endif
+
+/* every packet, by index */
+#define HARNESS_COUNT(name) + 1
+#define HARNESS_CHECK(name) name##_check,
+#define HARNESS_FUZZ(name) name##_fuzz,
+enum { HARNESS_PACKETS = 0 SCHEMA_PACKETS(HARNESS_COUNT) };
+#ifndef HARNESS_FUZZER
+static void (*const harness_check[])(void) = {
+  SCHEMA_PACKETS(HARNESS_CHECK)
+};
+#endif
+static void (*const harness_fuzz[])(const uint8_t*, size_t) = {
+  SCHEMA_PACKETS(HARNESS_FUZZ)
+};
+
+/**
+ * \brief        Fuzz entry point (libFuzzer).
+ * \param data   Input: the index of the packet, and the payload.
+ * \param size   Input length.
+ * \return       0.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size > 0) harness_fuzz[data[0] % HARNESS_PACKETS](data + 1, size - 1);
+  return 0;
+}
+
+#ifndef HARNESS_FUZZER
+/* replay an input file */
+static void harness_replay(const char* path) {
+  static uint8_t in[HARNESS_MAX + 1];
+  size_t n;
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    exit(2);
+  }
+  n = fread(in, 1, sizeof(in), f);
+  fclose(f);
+  LLVMFuzzerTestOneInput(in, n);
+}
+
+int main(int argc, char** argv) {
+  long rounds = argc > 1 ? atol(argv[1]) : 100, r;
+  int i;
+  if (argc > 1 && strcmp(argv[1], "-f") == 0) {
+    for (i = 2; i < argc; i++) harness_replay(argv[i]);
+    printf("%d inputs: ok\n", argc - 2);
+    return 0;
+  }
+  if (argc > 2) harness_state = (uint64_t)atol(argv[2]) | 1;
+  if ((i = mkstemp(harness_log)) < 0) {
+    perror(harness_log);
+    exit(2);
+  }
+  close(i);
+  harness_registry();
+  for (r = 0; r < rounds; r++) {
+    for (i = 0; i < HARNESS_PACKETS; i++) harness_check[i]();
+    /* and random payloads */
+    harness_bytes(harness_pl[0], 1 + harness_random() % 512);
+    LLVMFuzzerTestOneInput(harness_pl[0], 1 + harness_random() % 512);
+  }
+  unlink(harness_log);
+  printf("%d packets, %ld rounds: ok\n", (int)HARNESS_PACKETS, rounds);
+  return 0;
+}
+#endif
@@ -0,0 +1,81 @@
+#!/usr/bin/env bash
+#
+# XPacket
+# Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Differential harness, for every combination of the options.
+#
+# For S schemas (of 20 random packets, see schema.sh) it builds the harness
+# with every option changing the payload (that the reference encoder of
+# spec.h follows too), and with every option changing the code only (the
+# table-driven functions and the vector extensions), and runs R rounds of
+# checks; for every payload option it also checks the C++ traits
+# (traits.cpp). The compilers and the options are given by CC,
+# CXX and CFLAGS, and the script fails at the first difference:
+#   CC=gcc CFLAGS="-O1 -fsanitize=address,undefined" ./run.sh 4 200
+# (the vector extensions not supported by the CPU are skipped).
+
+set -e
+S=${1:-1}
+R=${2:-100}
+CC=${CC:-cc}
+CXX=${CXX:-c++}
+CFLAGS=${CFLAGS:--O2}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+WIRE=(
+  ""
+  "-DXPACKET_LITTLE_ENDIAN"
+  "-DXPACKET_SCHEMA_PREFIX"
+  "-DXPACKET_CHECKSUM"
+  "-DXPACKET_DELTA"
+  "-DXPACKET_ARENA"
+  "-DXPACKET_ARENA -DXPACKET_ARENA_ALIAS"
+  "-DXPACKET_COLUMNS"
+  "-DXPACKET_IOV"
+  "-DXPACKET_SIZE_TYPE=uint32_t"
+  "-DXPACKET_LITTLE_ENDIAN -DXPACKET_SCHEMA_PREFIX -DXPACKET_CHECKSUM
+    -DXPACKET_DELTA -DXPACKET_ARENA -DXPACKET_COLUMNS -DXPACKET_IOV"
+)
+CODE=("" "-DXPACKET_TABLE_DRIVEN")
+ISA=
+for isa in ssse3 avx2 sse4_2; do
+  if grep -qw $isa /proc/cpuinfo 2>/dev/null; then
+    CODE+=("-m${isa/_/.}")
+    ISA="$ISA -m${isa/_/.}"
+  fi
+done
+CODE+=("-DXPACKET_TABLE_DRIVEN$ISA")
+
+for wire in "${WIRE[@]}"; do
+  echo "traits:" $wire
+  $CXX -std=c++11 $CFLAGS $wire -I"$ROOT" "$ROOT/fuzz/traits.cpp" \
+    -o "$DIR/traits"
+  "$DIR/traits"
+done
+for ((s = 1; s <= S; s++)); do
+  "$ROOT/fuzz/schema.sh" $s 20 > "$DIR/schema.h"
+  for wire in "${WIRE[@]}"; do
+    for code in "${CODE[@]}"; do
+      echo "schema $s:" $wire $code
+      $CC -std=c99 $CFLAGS $wire $code -I"$DIR" -I"$ROOT" -I"$ROOT/fuzz" \
+        "$ROOT/fuzz/harness.c" -o "$DIR/harness"
+      "$DIR/harness" $R $s
+    done
+  done
+done
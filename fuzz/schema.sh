@@ -0,0 +1,84 @@
+#!/usr/bin/env bash
+#
+# XPacket
+# Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Random schema generator (for the differential harness).
+#
+# It prints a header of N random packets (p0, p1, ...), the same for the
+# same seed, without include guard; SCHEMA_PACKETS(P) lists the packets,
+# and SCHEMA_DISPATCH(P) the ones with an identifier (XPACKET_ID, all but
+# the ones with FIELD_CUSTOM fields). The packets are of four classes, so
+# every layout is covered: only FIELD and FIELD_PTR fields (table-driven
+# and columnar layouts), also FIELD_BITS (fixed layout), every kind but
+# FIELD_CUSTOM (variable layout), and every kind with a FIELD_CUSTOM (no
+# bounds-checked functions). The external functions are the ones of
+# harness.c:
+#   ./schema.sh 42 20 > schema.h
+
+set -e
+SEED=${1:-1}
+N=${2:-20}
+RANDOM=$SEED
+TYPES=(uint8_t uint16_t uint32_t uint64_t int8_t int16_t int32_t int64_t
+  float double)
+VARINTS=(uint8_t uint16_t uint32_t int8_t int16_t int32_t)
+BITS=(uint8_t uint16_t uint32_t)
+WIDTH=(8 16 32)
+
+echo "/* generated by schema.sh $SEED $N */"
+printf '#define SCHEMA_PACKETS(P)'
+for ((p = 0; p < N; p++)); do printf ' P(p%d)' $p; done
+printf '\n#define SCHEMA_DISPATCH(P)'
+for ((p = 0; p < N; p++)); do
+  if ((p % 4 != 3)); then printf ' P(p%d)' $p; fi
+done
+printf '\n'
+for ((p = 0; p < N; p++)); do
+  class=$((p % 4))
+  printf '#define XPACKET_NAME p%d\n' $p
+  if ((class != 3)); then printf '#define XPACKET_ID %d\n' $p; fi
+  printf '#define XPACKET_STRUCT'
+  nf=$((1 + RANDOM % 12))
+  custom=$((class == 3 ? RANDOM % nf : -1))
+  for ((f = 0; f < nf; f++)); do
+    t=${TYPES[$((RANDOM % 10))]}
+    kind=$((RANDOM % (class == 0 ? 4 : (class == 1 ? 6 : 10))))
+    if ((f == custom)); then kind=10; fi
+    case $kind in
+      0|4) printf ' \\\n  FIELD(%s, f%d)' $t $f ;;
+      1) printf ' \\\n  FIELD(%s, f%d, %d)' $t $f $((1 + RANDOM % 40)) ;;
+      2) printf ' \\\n  FIELD_PTR(%s, f%d)' $t $f ;;
+      3) printf ' \\\n  FIELD_PTR(%s, f%d, %d)' $t $f $((1 + RANDOM % 40)) ;;
+      5|6)
+        b=$((RANDOM % 3))
+        printf ' \\\n  FIELD_BITS(%s, f%d, %d)' ${BITS[$b]} $f \
+          $((1 + RANDOM % ${WIDTH[$b]})) ;;
+      7)
+        printf ' \\\n  FIELD(uint8_t, n%d) FIELD_VARRAY(%s, f%d, %d, n%d)' \
+          $f $t $f $((1 + RANDOM % 60)) $f ;;
+      8) printf ' \\\n  FIELD_VARINT(%s, f%d)' ${VARINTS[$((RANDOM % 6))]} $f ;;
+      9)
+        printf ' \\\n  FIELD_HOOK(uint16_t, f%d, harness_put_hook,' $f
+        printf ' \\\n    harness_get_hook)' ;;
+      10)
+        printf ' \\\n  FIELD_CUSTOM(uint32_t, f%d, harness_put_custom,' $f
+        printf ' \\\n    harness_get_custom)' ;;
+    esac
+  done
+  printf '\n#include "xpacket.h"\n#undef XPACKET_NAME\n#undef XPACKET_STRUCT\n'
+  if ((class != 3)); then printf '#undef XPACKET_ID\n'; fi
+done
@@ -0,0 +1,540 @@
+/*
+ * XPacket
+ * Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file spec.h
+ * \brief Reference encoder of the wire format (see check.h).
+ * \author Matteo Parolari <mparolari.dev@gmail.com>
+ * \copyright GNU Lesser General Public License version 3.
+ * \version 0.3
+ * \date 02/2018
+ *
+ *    Included by check.h for every packet msg, it generates:
+ *    \code{.c}
+ *    static size_t msg_spec_write(uint8_t* pl, const struct msg* m,
+ *      const struct msg* prev);
+ *    static size_t msg_spec_read(const uint8_t* pl, size_t len,
+ *      struct msg* m);
+ *    static size_t msg_spec_columns(uint8_t* out, const struct msg* v,
+ *      size_t n);
+ *    \endcode
+ *    written from the description of the payload, and not from the code
+ *    of xpacket.h (none of its macros, codecs, tables, varint, bit or
+ *    checksum functions is used): a cursor counts the bits written or
+ *    read, every field that is not a bit field begins at the next byte,
+ *    the values are moved a byte at a time, the varints and the checksum
+ *    a bit at a time. msg_spec_write serializes the whole packet (or the
+ *    delta from prev, if not NULL), msg_spec_read is the strict
+ *    deserialization (it returns 0 for a truncated or invalid payload),
+ *    and msg_spec_columns the columnar one (for the fixed layouts without
+ *    bits only).
+ */
+
+/*---------------------------------------------------------------------------*/
+/* shared by every packet */
+#ifndef HARNESS_SPEC
+#define HARNESS_SPEC
+
+/* cursor on the payload */
+struct harness_spec {
+  uint8_t* out;       /* payload written (NULL if it is read) */
+  const uint8_t* in;  /* payload read */
+  size_t len;         /* length of the payload read */
+  size_t bit;         /* position (in bits) */
+  uint8_t* map;       /* presence bitmap (only for a delta) */
+  size_t field;       /* index of the field in the bitmap */
+  int bad;            /* if not 0, the payload read is not valid */
+};
+
+/* properties of the types (the type codes of the schema identifier) */
+#define SPEC_SIGNED(type) ((type)-1 < (type)1)
+#define SPEC_FLOAT(type) ((type)0.5 != (type)0)
+#define SPEC_CODE(type) (SPEC_FLOAT(type) ? 8 + sizeof(type) / 4 : \
+  (sizeof(type) == 1 ? 1u : sizeof(type) == 2 ? 2u : \
+  sizeof(type) == 4 ? 3u : 4u) + (SPEC_SIGNED(type) ? 4u : 0u))
+
+/* every field that is not a bit field begins at the next byte */
+static void harness_spec_align(struct harness_spec* s) {
+  s->bit = (s->bit + 7) / 8 * 8;
+}
+
+/* the bytes of a value (of 1, 2, 4 or 8 bytes) in the payload order */
+static void harness_spec_put(struct harness_spec* s, const void* v,
+    size_t size) {
+  uint64_t u = 0;
+  size_t i;
+  uint8_t u8;
+  uint16_t u16;
+  uint32_t u32;
+  harness_spec_align(s);
+  switch (size) {
+    case 1: memcpy(&u8, v, 1); u = u8; break;
+    case 2: memcpy(&u16, v, 2); u = u16; break;
+    case 4: memcpy(&u32, v, 4); u = u32; break;
+    default: memcpy(&u, v, 8); break;
+  }
+  for (i = 0; i < size; i++) {
+    #ifdef XPACKET_LITTLE_ENDIAN
+    s->out[s->bit / 8 + i] = (uint8_t)(u >> 8 * i);
+    #else
+    s->out[s->bit / 8 + i] = (uint8_t)(u >> 8 * (size - 1 - i));
+    #endif
+  }
+  s->bit += 8 * size;
+}
+
+static void harness_spec_get(struct harness_spec* s, void* v, size_t size) {
+  uint64_t u = 0;
+  size_t i;
+  uint8_t u8;
+  uint16_t u16;
+  uint32_t u32;
+  harness_spec_align(s);
+  if (s->bad || s->bit / 8 + size > s->len) {
+    s->bad = 1;
+    return;
+  }
+  for (i = 0; i < size; i++) {
+    #ifdef XPACKET_LITTLE_ENDIAN
+    u |= (uint64_t)s->in[s->bit / 8 + i] << 8 * i;
+    #else
+    u |= (uint64_t)s->in[s->bit / 8 + i] << 8 * (size - 1 - i);
+    #endif
+  }
+  switch (size) {
+    case 1: u8 = (uint8_t)u; memcpy(v, &u8, 1); break;
+    case 2: u16 = (uint16_t)u; memcpy(v, &u16, 2); break;
+    case 4: u32 = (uint32_t)u; memcpy(v, &u32, 4); break;
+    default: memcpy(v, &u, 8); break;
+  }
+  s->bit += 8 * size;
+}
+
+/* the bits of a bit field, the most significant first */
+static uint32_t harness_spec_bits(const uint8_t* p, size_t bit,
+    unsigned nbits) {
+  uint32_t v = 0;
+  for (; nbits > 0; nbits--, bit++)
+    v = v << 1 | (uint32_t)(p[bit / 8] >> (7 - bit % 8) & 1);
+  return v;
+}
+
+static void harness_spec_put_bits(struct harness_spec* s, uint32_t v,
+    unsigned nbits) {
+  while (nbits-- > 0) {
+    uint8_t* byte = s->out + s->bit / 8;
+    if (s->bit % 8 == 0) *byte = 0; /* the unused bits are 0 */
+    if (v >> nbits & 1) *byte |= (uint8_t)(0x80 >> s->bit % 8);
+    s->bit++;
+  }
+}
+
+static uint32_t harness_spec_get_bits(struct harness_spec* s,
+    unsigned nbits) {
+  uint32_t v;
+  if (s->bad || (s->bit + nbits + 7) / 8 > s->len) {
+    s->bad = 1;
+    return 0;
+  }
+  v = harness_spec_bits(s->in, s->bit, nbits);
+  s->bit += nbits;
+  return v;
+}
+
+/* varints: 7 bits a byte (the lowest first) with a continuation bit, the */
+/* signed values zig-zag encoded (0, -1, 1, -2 ... as 0, 1, 2, 3 ...) */
+static uint32_t harness_spec_zigzag(int64_t v) {
+  return (uint32_t)(v < 0 ? -2 * v - 1 : 2 * v);
+}
+
+static int64_t harness_spec_unzigzag(uint32_t u) {
+  return u % 2 ? -(int64_t)(u / 2) - 1 : (int64_t)(u / 2);
+}
+
+static void harness_spec_put_varint(struct harness_spec* s, uint32_t v) {
+  harness_spec_align(s);
+  do {
+    s->out[s->bit / 8] = (uint8_t)(v % 128 + (v >= 128 ? 128 : 0));
+    s->bit += 8;
+    v /= 128;
+  } while (v > 0);
+}
+
+/* a valid varint of a type of "bits" bits has at most ceil(bits / 7) */
+/* bytes, and its value fits the type */
+static uint32_t harness_spec_get_varint(struct harness_spec* s,
+    unsigned bits) {
+  uint64_t v = 0;
+  unsigned i;
+  harness_spec_align(s);
+  for (i = 0; !s->bad; i++) {
+    uint8_t b;
+    if (s->bit / 8 >= s->len || i >= (bits + 6) / 7) s->bad = 1;
+    else {
+      b = s->in[s->bit / 8];
+      s->bit += 8;
+      v |= (uint64_t)(b % 128) << 7 * i;
+      if (b < 128) break;
+    }
+  }
+  if (v >> bits) s->bad = 1;
+  return (uint32_t)v;
+}
+
+#ifdef XPACKET_CHECKSUM
+/* CRC32C (Castagnoli, reflected polynomial 0x82f63b78), a bit at a time */
+static uint32_t harness_spec_crc(const uint8_t* p, size_t n) {
+  uint32_t crc = 0xffffffffu;
+  int k;
+  while (n--) {
+    crc ^= *p++;
+    for (k = 0; k < 8; k++)
+      crc = crc & 1 ? crc >> 1 ^ 0x82f63b78u : crc >> 1;
+  }
+  return ~crc;
+}
+#endif
+
+#if defined(XPACKET_SCHEMA_PREFIX) || !defined(HARNESS_FUZZER)
+/* schema identifier: FNV-1a (modulo 2^31 - 1) of the byte order, then of */
+/* the kind, type and size of every field */
+static uint32_t harness_spec_fold(uint32_t h, uint32_t v) {
+  return (uint32_t)((uint64_t)(h ^ v) * 16777619u % 2147483647u);
+}
+
+static uint32_t harness_spec_schema(uint32_t h, uint32_t kind,
+    uint32_t code, uint32_t dim) {
+  return harness_spec_fold(harness_spec_fold(harness_spec_fold(h, kind),
+    code), dim);
+}
+#endif
+
+/* a delta has a bit for every field: 1 if it is changed (and present) */
+static int harness_spec_present(struct harness_spec* s, int diff) {
+  size_t f = s->field++;
+  if (!s->map) return 1;
+  if (diff) s->map[f / 8] |= (uint8_t)(0x80 >> f % 8);
+  return diff;
+}
+#endif /* HARNESS_SPEC */
+
+/*---------------------------------------------------------------------------*/
+/* number of fields, and if the layout is fixed (only fields of a size */
+/* known at compile time) */
+#define FIELD_VAR(type, name)             + 1
+#define FIELD_ARRAY(type, name, dim)      + 1
+#define FIELD_PTR_VAR(type, name)         + 1
+#define FIELD_PTR_ARRAY(type, name, dim)  + 1
+#define FIELD_VARRAY(type, name, maxdim, lenfield) + 1
+#define FIELD_VARINT(type, name)          + 1
+#define FIELD_BITS(type, name, nbits)     + 1
+#define FIELD_CUSTOM(type, name, ser, de) + 1
+#define FIELD_HOOK(type, name, ser, de)   + 1
+enum { SPEC(fields) = 0 XPACKET_STRUCT };
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+#define FIELD_VAR(type, name)
+#define FIELD_ARRAY(type, name, dim)
+#define FIELD_PTR_VAR(type, name)
+#define FIELD_PTR_ARRAY(type, name, dim)
+#define FIELD_VARRAY(type, name, maxdim, lenfield) && 0
+#define FIELD_VARINT(type, name)          && 0
+#define FIELD_CUSTOM(type, name, ser, de) && 0
+#define FIELD_HOOK(type, name, ser, de)   && 0
+#define FIELD_BITS(type, name, nbits)
+enum { SPEC(fixed) = 1 XPACKET_STRUCT };
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+
+/* schema identifier (kind 1 for the fixed size fields, 2 for FIELD_VARRAY, */
+/* 3 for FIELD_VARINT, 4 for FIELD_BITS and 5 for the external functions) */
+#define FIELD_VAR(type, name) \
+  _h = harness_spec_schema(_h, 1, SPEC_CODE(type), 1);
+#define FIELD_ARRAY(type, name, dim) \
+  _h = harness_spec_schema(_h, 1, SPEC_CODE(type), dim);
+#define FIELD_PTR_VAR(type, name)         FIELD_VAR(type, name)
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+#define FIELD_VARRAY(type, name, maxdim, lenfield) \
+  _h = harness_spec_schema(_h, 2, SPEC_CODE(type), maxdim);
+#define FIELD_VARINT(type, name) \
+  _h = harness_spec_schema(_h, 3, SPEC_CODE(type), 1);
+#define FIELD_BITS(type, name, nbits) \
+  _h = harness_spec_schema(_h, 4, SPEC_CODE(type), nbits);
+#define FIELD_CUSTOM(type, name, ser, de) \
+  _h = harness_spec_schema(_h, 5, sizeof(type), 1);
+#define FIELD_HOOK(type, name, ser, de)   FIELD_CUSTOM(type, name, ser, de)
+#if !defined(HARNESS_FUZZER) || \
+  (defined(XPACKET_SCHEMA_PREFIX) && !defined(XPACKET_CUSTOM_FIELDS))
+static uint32_t SPEC(schema)(void) {
+  #ifdef XPACKET_LITTLE_ENDIAN
+  uint32_t _h = harness_spec_fold(2166136261u, 1);
+  #else
+  uint32_t _h = harness_spec_fold(2166136261u, 0);
+  #endif
+  XPACKET_STRUCT
+  return _h;
+}
+#endif
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+
+/* serialization (of the fields changed from _q, in a delta) */
+#define FIELD_VAR(type, name) \
+  harness_spec_align(&_s); \
+  if (harness_spec_present(&_s, \
+      memcmp(&_m->name, &_q->name, sizeof(type)) != 0)) \
+    harness_spec_put(&_s, &_m->name, sizeof(type));
+#define FIELD_ARRAY(type, name, dim) \
+  harness_spec_align(&_s); \
+  if (harness_spec_present(&_s, \
+      memcmp(_m->name, _q->name, sizeof(type) * (dim)) != 0)) \
+    for (_i = 0; _i < (dim); _i++) \
+      harness_spec_put(&_s, &_m->name[_i], sizeof(type));
+#define FIELD_PTR_VAR(type, name) \
+  harness_spec_align(&_s); \
+  if (harness_spec_present(&_s, \
+      memcmp(_m->name, _q->name, sizeof(type)) != 0)) \
+    harness_spec_put(&_s, _m->name, sizeof(type));
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+#define FIELD_VARRAY(type, name, maxdim, lenfield) \
+  harness_spec_align(&_s); \
+  if (harness_spec_present(&_s, _m->lenfield != _q->lenfield || \
+      memcmp(_m->name, _q->name, sizeof(type) * _m->lenfield) != 0)) \
+    for (_i = 0; _i < _m->lenfield; _i++) \
+      harness_spec_put(&_s, &_m->name[_i], sizeof(type));
+#define FIELD_VARINT(type, name) \
+  harness_spec_align(&_s); \
+  if (harness_spec_present(&_s, _m->name != _q->name)) \
+    harness_spec_put_varint(&_s, SPEC_SIGNED(type) ? \
+      harness_spec_zigzag((int64_t)_m->name) : (uint32_t)_m->name);
+#define FIELD_BITS(type, name, nbits) \
+  if (harness_spec_present(&_s, _m->name != _q->name)) \
+    harness_spec_put_bits(&_s, _m->name, nbits);
+#define FIELD_CUSTOM(type, name, ser, de) \
+  harness_spec_align(&_s); \
+  if (harness_spec_present(&_s, \
+      memcmp(&_m->name, &_q->name, sizeof(type)) != 0)) { \
+    XPACKET_SIZE_TYPE _n = 0; \
+    ser(_pl + _s.bit / 8, &_m->name, &_n); \
+    _s.bit += 8u * _n; \
+  }
+#define FIELD_HOOK(type, name, ser, de) \
+  harness_spec_align(&_s); \
+  if (harness_spec_present(&_s, \
+      memcmp(&_m->name, &_q->name, sizeof(type)) != 0)) { \
+    XPACKET_SIZE_TYPE _n = \
+      ser(_pl + _s.bit / 8, (XPACKET_SIZE_TYPE)-1, &_m->name); \
+    if (_n == 0) return 0; \
+    _s.bit += 8u * _n; \
+  }
+/**
+ * \brief        Serialize a packet, or a delta.
+ * \param _pl    Payload memory address.
+ * \param _m     Structure that will be serialized.
+ * \param _prev  Previous structure (NULL for the whole packet).
+ * \return       Number of bytes serialized.
+ *
+ *    The payload is: the schema identifier (with XPACKET_SCHEMA_PREFIX,
+ *    4 bytes), the presence bitmap (only for a delta), the fields, and
+ *    the checksum of all the bytes before it (with XPACKET_CHECKSUM, 4
+ *    bytes); the numbers are in the payload byte order.
+ */
+#if !defined(XPACKET_CUSTOM_FIELDS) || !defined(HARNESS_FUZZER)
+static size_t SPEC(write)(uint8_t* _pl, const struct XPACKET_NAME* _m,
+    const struct XPACKET_NAME* _prev) {
+  const struct XPACKET_NAME* _q = _prev ? _prev : _m;
+  struct harness_spec _s;
+  size_t _i;
+  memset(&_s, 0, sizeof(_s));
+  _s.out = _pl;
+  #ifdef XPACKET_SCHEMA_PREFIX
+  {
+    uint32_t _id = SPEC(schema)();
+    harness_spec_put(&_s, &_id, 4);
+  }
+  #endif
+  if (_prev) {
+    _s.map = _pl + _s.bit / 8;
+    memset(_s.map, 0, (SPEC(fields) + 7) / 8);
+    _s.bit += 8 * ((SPEC(fields) + 7) / 8);
+  }
+  XPACKET_STRUCT
+  harness_spec_align(&_s);
+  #ifdef XPACKET_CHECKSUM
+  {
+    uint32_t _crc = harness_spec_crc(_pl, _s.bit / 8);
+    harness_spec_put(&_s, &_crc, 4);
+  }
+  #endif
+  (void)_i;
+  return _s.bit / 8;
+}
+#endif
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+
+/* deserialization (every function of a field does nothing once invalid, */
+/* and the external ones are not called) */
+#define FIELD_VAR(type, name) \
+  harness_spec_get(&_s, &_m->name, sizeof(type));
+#define FIELD_ARRAY(type, name, dim) \
+  for (_i = 0; _i < (dim); _i++) \
+    harness_spec_get(&_s, &_m->name[_i], sizeof(type));
+#define FIELD_PTR_VAR(type, name) \
+  harness_spec_get(&_s, _m->name, sizeof(type));
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+#define FIELD_VARRAY(type, name, maxdim, lenfield) \
+  if (_m->lenfield > (maxdim)) _s.bad = 1; \
+  for (_i = 0; _i < _m->lenfield && !_s.bad; _i++) \
+    harness_spec_get(&_s, &_m->name[_i], sizeof(type));
+#define FIELD_VARINT(type, name) \
+  { \
+    uint32_t _u = harness_spec_get_varint(&_s, 8 * sizeof(type)); \
+    _m->name = (type)(SPEC_SIGNED(type) ? harness_spec_unzigzag(_u) : \
+      (int64_t)_u); \
+  }
+#define FIELD_BITS(type, name, nbits) \
+  _m->name = (type)harness_spec_get_bits(&_s, nbits);
+/* FIELD_CUSTOM does not know the length: it's checked after */
+#define FIELD_CUSTOM(type, name, ser, de) \
+  harness_spec_align(&_s); \
+  if (!_s.bad) { \
+    XPACKET_SIZE_TYPE _n = 0; \
+    de(_pl + _s.bit / 8, &_m->name, &_n); \
+    _s.bit += 8u * _n; \
+    if (_s.bit / 8 > _len) _s.bad = 1; \
+  }
+#define FIELD_HOOK(type, name, ser, de) \
+  harness_spec_align(&_s); \
+  if (!_s.bad && _s.bit / 8 <= _len) { \
+    XPACKET_SIZE_TYPE _n = de(_pl + _s.bit / 8, \
+      (XPACKET_SIZE_TYPE)(_len - _s.bit / 8), &_m->name); \
+    if (_n == 0) _s.bad = 1; \
+    _s.bit += 8u * _n; \
+  }
+/**
+ * \brief        Deserialize a packet, checking it.
+ * \param _pl    Payload memory address.
+ * \param _len   Payload length.
+ * \param _m     Structure where the values are saved.
+ * \return       Number of bytes deserialized, or 0 if the payload is
+ *               truncated or not valid (a different schema identifier or
+ *               checksum, a length over the maximum, a varint not fitting
+ *               its type, or a FIELD_HOOK function failing).
+ */
+#if !defined(XPACKET_CUSTOM_FIELDS) || !defined(HARNESS_FUZZER)
+static size_t SPEC(read)(const uint8_t* _pl, size_t _len,
+    struct XPACKET_NAME* _m) {
+  struct harness_spec _s;
+  size_t _i;
+  memset(&_s, 0, sizeof(_s));
+  _s.in = _pl;
+  _s.len = _len;
+  #ifdef XPACKET_SCHEMA_PREFIX
+  {
+    uint32_t _id;
+    harness_spec_get(&_s, &_id, 4);
+    if (!_s.bad && _id != SPEC(schema)()) return 0;
+  }
+  #endif
+  XPACKET_STRUCT
+  harness_spec_align(&_s);
+  #ifdef XPACKET_CHECKSUM
+  {
+    uint32_t _crc;
+    size_t _end = _s.bit / 8;
+    harness_spec_get(&_s, &_crc, 4);
+    if (!_s.bad && _crc != harness_spec_crc(_pl, _end)) return 0;
+  }
+  #endif
+  (void)_i;
+  return _s.bad ? 0 : _s.bit / 8;
+}
+#endif
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+
+#if defined(XPACKET_COLUMN_LAYOUT) && !defined(HARNESS_FUZZER)
+/* columnar serialization: the values of every field, one after the other */
+#define FIELD_VAR(type, name) \
+  for (_i = 0; _i < _n; _i++) \
+    harness_spec_put(&_s, &_v[_i].name, sizeof(type));
+#define FIELD_ARRAY(type, name, dim) \
+  for (_i = 0; _i < _n * (dim); _i++) \
+    harness_spec_put(&_s, &_v[_i / (dim)].name[_i % (dim)], sizeof(type));
+#define FIELD_PTR_VAR(type, name) \
+  for (_i = 0; _i < _n; _i++) \
+    harness_spec_put(&_s, _v[_i].name, sizeof(type));
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+/**
+ * \brief        Serialize an array of structures, a field after the other.
+ * \param _out   Payload memory address.
+ * \param _v     Structures that will be serialized.
+ * \param _n     Number of structures.
+ * \return       Number of bytes serialized (without the schema identifier
+ *               and the checksum).
+ */
+static size_t SPEC(columns)(uint8_t* _out, const struct XPACKET_NAME* _v,
+    size_t _n) {
+  struct harness_spec _s;
+  size_t _i;
+  memset(&_s, 0, sizeof(_s));
+  _s.out = _out;
+  XPACKET_STRUCT
+  return _s.bit / 8;
+}
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#endif
@@ -0,0 +1,98 @@
+/*
+ * XPacket
+ * Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file traits.cpp
+ * \brief Check of the C++ traits (see harness.c).
+ * \author Matteo Parolari <mparolari.dev@gmail.com>
+ * \copyright GNU Lesser General Public License version 3.
+ * \version 0.3
+ * \date 02/2018
+ *
+ *    The layout of xpacket::traits must match the payload with the options
+ *    changing it (e.g. XPACKET_CHECKSUM or XPACKET_SCHEMA_PREFIX), and a
+ *    std::array of wire_size bytes must fit the packet:
+ *    \code{.sh}
+ *    c++ -std=c++11 -I.. -DXPACKET_CHECKSUM traits.cpp -o traits && ./traits
+ *    \endcode
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#define XPACKET_NAME msg
+#define XPACKET_STRUCT \
+  FIELD(uint16_t, a) \
+  FIELD(uint8_t, b, 32)
+#include "xpacket.hpp"
+#undef XPACKET_NAME
+#undef XPACKET_STRUCT
+
+#define XPACKET_NAME vmsg
+#define XPACKET_STRUCT \
+  FIELD(uint16_t, a) \
+  FIELD(uint8_t, n) \
+  FIELD_VARRAY(uint8_t, b, 32, n)
+#include "xpacket.hpp"
+#undef XPACKET_NAME
+#undef XPACKET_STRUCT
+
+/* bytes before and after the fields */
+#ifdef XPACKET_SCHEMA_PREFIX
+#define TRAITS_PREFIX 4
+#else
+#define TRAITS_PREFIX 0
+#endif
+#ifdef XPACKET_CHECKSUM
+#define TRAITS_SUFFIX 4
+#else
+#define TRAITS_SUFFIX 0
+#endif
+
+typedef xpacket::traits<msg> fixed;
+typedef xpacket::traits<vmsg> variable;
+static_assert(fixed::fixed_layout, "msg layout");
+static_assert(fixed::wire_size == 34 + TRAITS_PREFIX + TRAITS_SUFFIX,
+  "msg wire_size");
+static_assert(fixed::wire_size == msg_WIRE_SIZE, "msg WIRE_SIZE");
+static_assert(fixed::prefix_size == 34 + TRAITS_PREFIX, "msg prefix_size");
+static_assert(!variable::fixed_layout, "vmsg layout");
+static_assert(variable::prefix_size == 3 + TRAITS_PREFIX, "vmsg prefix_size");
+
+/* wire_size is generated only for a fixed layout */
+template <typename T>
+static constexpr bool has_wire_size(decltype(&T::wire_size)) { return true; }
+template <typename T>
+static constexpr bool has_wire_size(...) { return false; }
+static_assert(has_wire_size<fixed>(0), "msg wire_size");
+static_assert(!has_wire_size<variable>(0), "vmsg wire_size");
+
+int main() {
+  std::array<uint8_t, fixed::wire_size> buf;
+  msg a, b;
+  a.a = 0x1234;
+  for (std::size_t i = 0; i < sizeof(a.b); i++) a.b[i] = (uint8_t)i;
+  if (fixed::serialize(buf, a) != fixed::wire_size ||
+      fixed::deserialize(buf, b) != fixed::wire_size ||
+      b.a != a.a || std::memcmp(b.b, a.b, sizeof(a.b)) != 0) {
+    std::fprintf(stderr, "traits: msg differs\n");
+    return 1;
+  }
+  std::printf("traits: ok\n");
+  return 0;
+}
@@ -27,9 +27,6 @@
  * \warning If more arguments are used than needed, behavior is undefined.
  * \todo Add an automatic delimiter (like '\0') to the arrays
  * \todo Check number of arguments in overloading macro.
- * \todo Signed type marshalling.
- * \todo Graceful error handling.
- * \todo Enable/disable inline attribute.
  *
  *    XPacket is an utility that generates a C struct and two functions
  *    for serialize/deserialize it into/from a given payload.
@@ -48,10 +45,38 @@
  *      or an array if "dim" argument is given.
  *    * FIELD_PTR(type, name, [dim]): a pointer to a variable;
  *      or a pointer to an array if "dim" argument is given.
+ *    * FIELD_VARRAY(type, name, maxdim, lenfield): an array of "maxdim"
+ *      elements, where only the first "lenfield" ones are serialized;
+ *      "lenfield" is the name of a previous field (e.g. FIELD(uint8_t, n))
+ *      that holds the number of used elements, so it's the length prefix.
+ *    * FIELD_VARINT(type, name): a variable serialized as a varint (LEB128,
+ *      so small values take less bytes); also the signed types int8_t,
+ *      int16_t, int32_t are supported, with zig-zag encoding.
+ *    * FIELD_BITS(type, name, nbits): a variable serialized in its lowest
+ *      "nbits" bits only; consecutive bit fields are packed in the same
+ *      bytes (most significant bit first), and the following field starts
+ *      at the next byte.
+ *    * FIELD_HOOK(type, name, ser, de): a variable serialized by the given
+ *      functions, with prototypes
+ *      uint16_t ser(uint8_t* pl, uint16_t len, const type* v) and
+ *      uint16_t de(const uint8_t* pl, uint16_t len, type* v),
+ *      that get the available bytes "len" and return the number of bytes
+ *      written/read, or 0 if they are not enough (or the data are invalid);
+ *      if they are static inline, they can be inlined like the other fields.
+ *    * FIELD_CUSTOM(type, name, ser, de): a variable serialized by the given
+ *      functions, with prototypes
+ *      void ser(uint8_t* pl, const type* v, uint16_t* idx) and
+ *      void de(const uint8_t* pl, type* v, uint16_t* idx),
+ *      that advance "idx" by the bytes written/read; they do not know the
+ *      available bytes, so the bounds-checked functions are not generated
+ *      for the packet (FIELD_HOOK is the bounds-checked equivalent).
  *
- *    Only unsigned types are currently supported: uint8_t, uint16_t, uint32_t
- *    from stdint.h header, that are supposed to have fixed size (operator
- *    sizeof is used at compile time).
+ *    Supported types are the integers uint8_t, uint16_t, uint32_t, uint64_t,
+ *    int8_t, int16_t, int32_t, int64_t from stdint.h header, and the
+ *    floating point float and double (supposed to be IEEE 754, so they are
+ *    serialized as their bit pattern, like uint32_t and uint64_t); they
+ *    are supposed to have fixed size (operator sizeof is used at compile
+ *    time). Only unsigned types up to uint32_t are supported by FIELD_BITS.
  *
  *    For example:
  *    \code{.c}
@@ -71,21 +96,237 @@
  *    };
  *    uint16_t serialize_msg(uint8_t*, const struct msg*);
  *    uint16_t deserialize_msg(const uint8_t*, struct msg*);
+ *    uint16_t serialize_n_msg(uint8_t*, uint16_t, const struct msg*);
+ *    uint16_t deserialize_n_msg(const uint8_t*, uint16_t, struct msg*);
  *    \endcode
+ *    where the "_n" functions are the bounds-checked variants: they take
+ *    also the payload capacity/length, and return 0 if it's not enough
+ *    (e.g. a truncated input) or the input is not valid (e.g. a varint
+ *    not fitting its type), without writing/reading past it; they are
+ *    not generated if the packet has FIELD_CUSTOM fields.
+ *
+ *    The sizes (payload length, returned bytes, and the indexes of the
+ *    views, the FIELD_CUSTOM functions and the FIELD_HOOK ones) are
+ *    uint16_t, so packets are limited to 65535 bytes; for larger packets,
+ *    define XPACKET_SIZE_TYPE as a wider unsigned type (e.g. uint32_t or
+ *    size_t) before including xpacket.h the first time (the same type is
+ *    used by every packet), while the default produces tighter code on
+ *    the small targets.
+ *
+ *    If the packet has a fixed layout (no FIELD_VARRAY, FIELD_VARINT,
+ *    FIELD_CUSTOM or FIELD_HOOK fields, while FIELD_BITS ones are allowed),
+ *    also the compile-time constant msg_WIRE_SIZE (the number of bytes of
+ *    the serialized packet, 38 in the example) is generated, so the
+ *    buffers can be statically sized; moreover, the
+ *    functions
+ *    \code{.c}
+ *    size_t serialize_batch_msg(uint8_t*, const struct msg*, size_t);
+ *    size_t deserialize_batch_msg(const uint8_t*, struct msg*, size_t);
+ *    \endcode
+ *    (de)serialize an array of structures as contiguous records of
+ *    msg_WIRE_SIZE bytes each.
+ *    The function
+ *    \code{.c}
+ *    size_t feed_msg(struct msg_decoder*, struct msg*, const uint8_t*, size_t);
+ *    \endcode
+ *    is a streaming deserializer: it can be called with the fragments of
+ *    the payload as they arrive (e.g. from a socket), and every field is
+ *    deserialized as soon as all its bytes are fed, so only the fields split
+ *    between two fragments are buffered in the msg_decoder state.
+ *
+ *    Moreover, for every field preceding the first variable-size one (so
+ *    the ones with a constant offset in the payload), the compile-time
+ *    constants msg_OFF_a, msg_OFF_b, ... (the byte offset of the field in
+ *    the payload; for a bit field, the byte holding its first bit, while
+ *    msg_BIT_x is the offset of that bit) are generated, as well as the views
+ *    \code{.c}
+ *    uint16_t msg_get_a(const uint8_t*);
+ *    void msg_set_a(uint8_t*, uint16_t);
+ *    uint8_t msg_get_b(const uint8_t*, uint16_t);
+ *    void msg_set_b(uint8_t*, uint16_t, uint8_t);
+ *    \endcode
+ *    read/write a single field (or array element) directly in the payload,
+ *    without (de)serializing the whole packet.
+ *
+ *    The compile-time constant msg_SCHEMA_ID is a 31-bit fingerprint of
+ *    the wire format (byte order, and kind, type and size of every field,
+ *    in order; not the names), so the two ends of a link can cheaply check
+ *    that they agree on XPACKET_STRUCT. If the XPACKET_SCHEMA_PREFIX macro
+ *    is defined, it's serialized (as uint32_t) before the fields, and the
+ *    deserialization fails (returning 0) if the payload has a different
+ *    one; the prefix is included in offsets and wire size, but it is not
+ *    checked by feed_msg.
+ *
+ *    If the XPACKET_CHECKSUM macro is defined, the CRC32C of the previous
+ *    bytes is serialized (as uint32_t) after the fields, and the
+ *    deserialization fails (returning 0) if it does not match, so corrupted
+ *    payloads are detected; it's computed in a single pass right after the
+ *    fields, while they are still in the cache, with the crc32 instructions
+ *    if the target has them (SSE 4.2, e.g. -msse4.2, or ARMv8 CRC) and a
+ *    table otherwise. Like the prefix, it's included in the wire size, but it
+ *    is not checked by feed_msg; xpacket_crc32c(crc, p, n) can be used for
+ *    other data too.
  *
  *    A decent compiler is necessary for optimize (roll/unroll) the loops.
  *    Attributes (such as __attribute__((__packed__))) can be assigned to
  *    the structure by simply adding them before include xpacket.h.
  *
- *    The two functions are defined only if macro XPACKET_C is defined;
+ *    The functions are defined only if macro XPACKET_C is defined;
  *    in this way struct and functions declaration can be easily separeted
  *    in an header, while the definitions are placed in a C file.
  *
+ *    If the XPACKET_IOV macro is defined (POSIX systems only), also the
+ *    function
+ *    \code{.c}
+ *    uint16_t serialize_iov_msg(uint8_t*, struct iovec*, const struct msg*);
+ *    \endcode
+ *    is generated: it fills (at most msg_IOV_ENTRIES) iovec entries with the
+ *    serialized packet, ready for writev/sendmsg, where the FIELD_PTR_ARRAY
+ *    data are directly referenced when they do not need any conversion
+ *    (uint8_t arrays, or in the host byte order), so only the other fields
+ *    are serialized in the given payload.
+ *
+ *    If the XPACKET_ARENA macro is defined, also the function
+ *    \code{.c}
+ *    uint16_t deserialize_arena_msg(const uint8_t*, uint16_t, struct msg*,
+ *      struct xpacket_arena*);
+ *    \endcode
+ *    is generated (without FIELD_CUSTOM fields): it's like
+ *    deserialize_n_msg, but the targets of the FIELD_PTR fields are
+ *    allocated (in order) from the given bump allocator (a memory region,
+ *    with its capacity and the number of bytes used); if also
+ *    XPACKET_ARENA_ALIAS is defined, the targets that do not need any
+ *    conversion point directly in the payload instead.
+ *
+ *    If the XPACKET_TABLE_DRIVEN macro is defined, and the packet has
+ *    only FIELD and FIELD_PTR fields, the (de)serialization is not unrolled:
+ *    a constant table describes the fields (kind, element size, offset in
+ *    the structure and number of elements), and a loop shared by every
+ *    packet interprets it, merging the fields that are contiguous in the
+ *    structure (so the code size is not proportional to the number of
+ *    fields, but it's usually slower); the streaming deserializer buffers
+ *    the whole packet, while the other functions are not changed.
+ *
+ *    If the XPACKET_DELTA macro is defined, the delta encoding is generated
+ *    too, for the streams where only a few fields change between packets:
+ *    \code{.c}
+ *    uint16_t serialize_delta_msg(uint8_t*, const struct msg* cur,
+ *      const struct msg* prev);
+ *    uint16_t deserialize_delta_msg(const uint8_t*, struct msg* prev);
+ *    \endcode
+ *    where the payload is a presence bitmap (msg_DELTA_MAP bytes, a bit for
+ *    every field) followed only by the fields changed from "prev", and the
+ *    deserialization patches the previous structure in place (so the two
+ *    ends must agree on it, e.g. sending a full packet periodically); like
+ *    in the full packets, the schema identifier (with XPACKET_SCHEMA_PREFIX)
+ *    precedes the bitmap and the checksum (with XPACKET_CHECKSUM) follows
+ *    the fields.
+ *
+ *    If the XPACKET_COLUMNS macro is defined, and the packet has only
+ *    FIELD and FIELD_PTR fields, the columnar batch functions
+ *    \code{.c}
+ *    size_t serialize_columns_msg(uint8_t*, const struct msg*, size_t);
+ *    size_t deserialize_columns_msg(const uint8_t*, struct msg*, size_t);
+ *    void msg_get_column_a(const uint8_t*, size_t n, uint16_t*);
+ *    \endcode
+ *    are generated too: for n records the payload holds the column of "a"
+ *    (its n values), then the one of "b", and so on (n * WIRE_SIZE bytes,
+ *    without the schema prefix and the checksum), so a scan decodes only
+ *    the columns it needs (msg_get_column_x), and every column is a
+ *    contiguous run of the same type (easy to vectorize, or compress).
+ *
+ *    If the XPACKET_TRACE_BEGIN(name) and XPACKET_TRACE_END(name, bytes)
+ *    macros are defined, they are invoked (as statements) at the entry and
+ *    at every return of every generated function: (de)serialize, _n, _batch,
+ *    deserialize_arena, serialize_iov, _delta, _columns and feed (not the
+ *    views and the column readers), with the function and packet name as a
+ *    string literal ("serialize_msg", ...) and the number of bytes (the
+ *    returned one, 0 if failed; the ones of the iovec entries for
+ *    serialize_iov, and the consumed ones for feed); so they can update
+ *    per-thread counters, or fire perf/USDT probes, while by default they
+ *    compile to nothing. The _n functions of a fixed layout are traced as
+ *    the unchecked ones they call.
+ *    \code{.c}
+ *    #define XPACKET_TRACE_BEGIN(name) DTRACE_PROBE(xpacket, begin)
+ *    #define XPACKET_TRACE_END(name, bytes) \
+ *      DTRACE_PROBE2(xpacket, end, name, bytes)
+ *    \endcode
+ *
+ *    If the XPACKET_INLINE macro is defined, the functions are static
+ *    inline, so they can be inlined in the caller (XPACKET_C must be
+ *    defined too, in every file that includes the packet).
+ *
+ *    With many packets and many files, the definitions should be placed in
+ *    a single file (defining XPACKET_C), so every function is compiled once.
+ *    The script bench/build.sh measures the build time of a large schema
+ *    in this way, against a previous version of xpacket.h: the options
+ *    make each inclusion more expensive (with 60 packets and gcc -O2, the
+ *    declarations take about 2.9 ms per packet and file instead of 0.5 ms),
+ *    since the layout constants, the views and the checks are generated
+ *    when the packet is declared.
+ *
+ *    The C++ header xpacket.hpp can be included instead of xpacket.h: it
+ *    generates also the xpacket::traits<msg> specialization, with the layout
+ *    as constexpr members (wire_size, offset_a, ...) and the functions for
+ *    std::array and std::span buffers (see the header for the details).
+ *
+ *    The header xpacket_log.h appends the packets of a fixed layout to a
+ *    file, and maps it back in memory: the records can then be accessed in
+ *    constant time by index, and read with the views without any copy
+ *    (see the header for the details).
+ *
+ *    The header xpacket_ring.h is a lock-free ring of slots of WIRE_SIZE
+ *    bytes: many threads reserve a slot, serialize the packet directly in
+ *    it and commit it, while a single thread gets the committed packets
+ *    in contiguous runs, that can be sent with a single call (see the
+ *    header for the details).
+ *
+ *    If the XPACKET_ID macro is defined (from 0 to 255, and redefined for
+ *    every packet, like XPACKET_NAME), the packet is registered for the
+ *    header xpacket_dispatch.h: given the list of the packets sharing a
+ *    channel, it generates the registry (identifier, wire size and
+ *    deserialize_n of every packet), the tagged union of their structures,
+ *    and the dispatch of a frame (the identifier followed by the packet) to
+ *    its deserialization (see the header for the details); so a packet with
+ *    FIELD_CUSTOM fields cannot be registered.
+ *
  *    If the XPACKET_OVERLOADING macro is defined, the functions will be
  *    simply called "serialize" and "deserialize"; while this may generate
  *    name conflicts in the C language, in C++ overloading can solve the
  *    possible ambiguity.
  *
+ *    The data are serialized in big-endian byte order; if the
+ *    XPACKET_LITTLE_ENDIAN macro is defined, little-endian byte order is
+ *    used instead. When the byte order of the payload matches the host one,
+ *    every field is simply copied (a single unaligned load/store), otherwise
+ *    it is byte-swapped (with the compiler builtins, if available). The arrays
+ *    are swapped a vector at a time, with the instructions enabled by the
+ *    compiler options (AVX2, SSSE3, SSE2 or NEON, e.g. with -march=native),
+ *    and the remaining elements one by one.
+ *
+ *    If the XPACKET_PORTABLE macro is defined (before the first inclusion),
+ *    the host is considered unknown: every field is serialized byte by byte
+ *    with shifts, and the checksum with the table, without copies, builtins
+ *    or special instructions. It's the reference for the other modes: the
+ *    same XPACKET_STRUCT can be generated with another name (e.g. msg_ref)
+ *    in a file that defines XPACKET_PORTABLE, and the two functions must
+ *    produce the same bytes on random data; while the bounds-checked
+ *    deserialization can be fuzzed (e.g. with libFuzzer):
+ *    \code{.c}
+ *    int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+ *      struct msg m;
+ *      uint32_t c;
+ *      m.c = &c; // the target of the FIELD_PTR field
+ *      if (size <= XPACKET_SIZE_MAX) deserialize_n_msg(data, size, &m);
+ *      return 0;
+ *    }
+ *    \endcode
+ *    The fuzz directory has a harness doing both for random schemas
+ *    (schema.sh), with every combination of the options (run.sh), but
+ *    against an encoder written apart from the header (spec.h), that
+ *    follows the payload field by field: it checks the views, the
+ *    columns, the dispatch and the ring and log headers too.
+ *
  *    The macros can be safely undefined after the header inclusion;
  *    it's a common practice redefine their values for include the xpacket
  *    header again, in order to generate another different structure
@@ -103,6 +344,658 @@
 #error "XPacket - XPACKET_STRUCT not defined"
 #else /* endif is at the end of the file */
 /*---------------------------------------------------------------------------*/
+/* common definitions, generated only once (shared by every packet) */
+#ifndef XPACKET_COMMON
+#define XPACKET_COMMON
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+/* type of the sizes (payload length, indexes and number of elements) */
+#ifndef XPACKET_SIZE_TYPE
+#define XPACKET_SIZE_TYPE uint16_t
+#endif
+#define XPACKET_SIZE_MAX ((XPACKET_SIZE_TYPE)-1)
+/* host byte order (if it is unknown, the portable implementation is used; */
+/* XPACKET_PORTABLE forces it, as the reference for the other ones) */
+#if defined(XPACKET_PORTABLE)
+#elif defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define XPACKET_HOST_BIG_ENDIAN
+#elif (defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+#define XPACKET_HOST_LITTLE_ENDIAN
+#endif
+/* byte swapping builtins (if available) */
+#if defined(__GNUC__)
+#define XPACKET_BSWAP16(x) __builtin_bswap16(x)
+#define XPACKET_BSWAP32(x) __builtin_bswap32(x)
+#define XPACKET_BSWAP64(x) __builtin_bswap64(x)
+#elif defined(_MSC_VER)
+#include <stdlib.h>
+#define XPACKET_BSWAP16(x) _byteswap_ushort(x)
+#define XPACKET_BSWAP32(x) _byteswap_ulong(x)
+#define XPACKET_BSWAP64(x) _byteswap_uint64(x)
+#endif
+/* serialization of a type in a byte order equal to the host one: copy */
+#define XPACKET_CODEC_NATIVE(order, type, bswap) \
+  static inline void xpacket_put_##order##_##type(uint8_t* pl, type v) { \
+    memcpy(pl, &v, sizeof(type)); \
+  } \
+  static inline type xpacket_get_##order##_##type(const uint8_t* pl) { \
+    type v; \
+    memcpy(&v, pl, sizeof(type)); \
+    return v; \
+  } \
+  static inline void xpacket_put_array_##order##_##type \
+      (uint8_t* pl, const type* src, XPACKET_SIZE_TYPE n) { \
+    memcpy(pl, src, sizeof(type) * n); \
+  } \
+  static inline void xpacket_get_array_##order##_##type \
+      (const uint8_t* pl, type* dst, XPACKET_SIZE_TYPE n) { \
+    memcpy(dst, pl, sizeof(type) * n); \
+  }
+/* serialization in the opposite byte order: swap and copy */
+#define XPACKET_CODEC_SWAP(order, type, bswap) \
+  static inline void xpacket_put_##order##_##type(uint8_t* pl, type v) { \
+    v = bswap(v); \
+    memcpy(pl, &v, sizeof(type)); \
+  } \
+  static inline type xpacket_get_##order##_##type(const uint8_t* pl) { \
+    type v; \
+    memcpy(&v, pl, sizeof(type)); \
+    return bswap(v); \
+  } \
+  XPACKET_CODEC_ARRAY(order, type)
+/* serialization with an unknown host: portable shifting */
+#define XPACKET_SHIFT_be(i, type) (((uint8_t)sizeof(type) - 1 - (i)) * 8)
+#define XPACKET_SHIFT_le(i, type) ((i) * 8)
+#define XPACKET_CODEC_SHIFT(order, type, bswap) \
+  static inline void xpacket_put_##order##_##type(uint8_t* pl, type v) { \
+    uint8_t i; \
+    for (i = 0; i < sizeof(type); i++) \
+      pl[i] = (uint8_t)(v >> XPACKET_SHIFT_##order(i, type)); \
+  } \
+  static inline type xpacket_get_##order##_##type(const uint8_t* pl) { \
+    type v = 0; \
+    uint8_t i; \
+    for (i = 0; i < sizeof(type); i++) \
+      v |= (type)((type)pl[i] << XPACKET_SHIFT_##order(i, type)); \
+    return v; \
+  } \
+  XPACKET_CODEC_ARRAY(order, type)
+/* arrays are serialized as a whole: the vector blocks (if any), then the */
+/* remaining elements one by one */
+#define XPACKET_CODEC_ARRAY(order, type) \
+  static inline void xpacket_put_array_##order##_##type \
+      (uint8_t* pl, const type* src, XPACKET_SIZE_TYPE n) { \
+    XPACKET_SIZE_TYPE i = (XPACKET_SIZE_TYPE)XPACKET_SWAP_BLOCKS_##order \
+      (pl, (const uint8_t*)src, n, sizeof(type)); \
+    pl += sizeof(type) * i; \
+    src += i; \
+    n -= i; \
+    for (i = 0; i < n; i++) \
+      xpacket_put_##order##_##type(pl + sizeof(type) * i, src[i]); \
+  } \
+  static inline void xpacket_get_array_##order##_##type \
+      (const uint8_t* pl, type* dst, XPACKET_SIZE_TYPE n) { \
+    XPACKET_SIZE_TYPE i = (XPACKET_SIZE_TYPE)XPACKET_SWAP_BLOCKS_##order \
+      ((uint8_t*)dst, pl, n, sizeof(type)); \
+    pl += sizeof(type) * i; \
+    dst += i; \
+    n -= i; \
+    for (i = 0; i < n; i++) \
+      dst[i] = xpacket_get_##order##_##type(pl + sizeof(type) * i); \
+  }
+/* serialization of the other types (signed, floating point) in a byte */
+/* order different from the host one: bit-cast into the unsigned type */
+#define XPACKET_CODEC_CAST(order, type, utype) \
+  static inline void xpacket_put_##order##_##type(uint8_t* pl, type v) { \
+    utype u; \
+    memcpy(&u, &v, sizeof(type)); \
+    xpacket_put_##order##_##utype(pl, u); \
+  } \
+  static inline type xpacket_get_##order##_##type(const uint8_t* pl) { \
+    utype u = xpacket_get_##order##_##utype(pl); \
+    type v; \
+    memcpy(&v, &u, sizeof(type)); \
+    return v; \
+  } \
+  XPACKET_CODEC_ARRAY(order, type)
+/* choose the implementation for both byte orders (be and le) */
+#if defined(XPACKET_HOST_BIG_ENDIAN)
+#define XPACKET_CODEC_be XPACKET_CODEC_NATIVE
+#elif defined(XPACKET_HOST_LITTLE_ENDIAN) && defined(XPACKET_BSWAP32)
+#define XPACKET_CODEC_be XPACKET_CODEC_SWAP
+#else
+#define XPACKET_CODEC_be XPACKET_CODEC_SHIFT
+#endif
+#if defined(XPACKET_HOST_LITTLE_ENDIAN)
+#define XPACKET_CODEC_le XPACKET_CODEC_NATIVE
+#elif defined(XPACKET_HOST_BIG_ENDIAN) && defined(XPACKET_BSWAP32)
+#define XPACKET_CODEC_le XPACKET_CODEC_SWAP
+#else
+#define XPACKET_CODEC_le XPACKET_CODEC_SHIFT
+#endif
+#if defined(XPACKET_HOST_BIG_ENDIAN)
+#define XPACKET_CODEC_CAST_be XPACKET_CODEC_NATIVE
+#else
+#define XPACKET_CODEC_CAST_be XPACKET_CODEC_CAST
+#endif
+#if defined(XPACKET_HOST_LITTLE_ENDIAN)
+#define XPACKET_CODEC_CAST_le XPACKET_CODEC_NATIVE
+#else
+#define XPACKET_CODEC_CAST_le XPACKET_CODEC_CAST
+#endif
+/* vector instructions, if the target has them, to swap whole blocks of */
+/* bytes (of 32 or 16 bytes) of the arrays in the opposite byte order */
+#if defined(XPACKET_PORTABLE)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define XPACKET_VECTOR 32
+#define XPACKET_VLOAD(p) _mm256_loadu_si256((const __m256i*)(p))
+#define XPACKET_VSTORE(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+#define XPACKET_VSWAP(v, mask) \
+  _mm256_shuffle_epi8(v, _mm256_setr_epi8(mask, mask))
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define XPACKET_VECTOR 16
+#define XPACKET_VLOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define XPACKET_VSTORE(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define XPACKET_VSWAP(v, mask) _mm_shuffle_epi8(v, _mm_setr_epi8(mask))
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+/* without byte shuffles: swap the bytes of the 16-bit words, then the */
+/* words of the elements */
+#include <emmintrin.h>
+#define XPACKET_VECTOR 16
+#define XPACKET_VLOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define XPACKET_VSTORE(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define XPACKET_VSWAP_W(v) _mm_or_si128(_mm_slli_epi16(v, 8), \
+  _mm_srli_epi16(v, 8))
+#define XPACKET_VSWAP_D(v, s) _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, s), s)
+#define XPACKET_VSWAP_2(v) XPACKET_VSWAP_W(v)
+#define XPACKET_VSWAP_4(v) XPACKET_VSWAP_D(XPACKET_VSWAP_W(v), 0xb1)
+#define XPACKET_VSWAP_8(v) XPACKET_VSWAP_D(XPACKET_VSWAP_W(v), 0x1b)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define XPACKET_VECTOR 16
+#define XPACKET_VLOAD(p) vld1q_u8(p)
+#define XPACKET_VSTORE(p, v) vst1q_u8(p, v)
+#define XPACKET_VSWAP_2(v) vrev16q_u8(v)
+#define XPACKET_VSWAP_4(v) vrev32q_u8(v)
+#define XPACKET_VSWAP_8(v) vrev64q_u8(v)
+#endif
+/* byte shuffles: position of every byte in its 16-byte lane */
+#ifdef XPACKET_VSWAP
+#define XPACKET_VMASK_2 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+#define XPACKET_VMASK_4 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+#define XPACKET_VMASK_8 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+#define XPACKET_VSWAP_2(v) XPACKET_VSWAP(v, XPACKET_VMASK_2)
+#define XPACKET_VSWAP_4(v) XPACKET_VSWAP(v, XPACKET_VMASK_4)
+#define XPACKET_VSWAP_8(v) XPACKET_VSWAP(v, XPACKET_VMASK_8)
+#endif
+#ifdef XPACKET_VECTOR
+/**
+ * \brief        Swap the elements of an array, a vector at a time.
+ * \param dst    Destination memory address (payload or array).
+ * \param src    Source memory address (array or payload).
+ * \param n      Number of elements.
+ * \param size   Size of an element (2, 4 or 8 bytes).
+ * \return       Number of elements swapped (the ones of the whole vectors).
+ */
+static inline size_t xpacket_swap_blocks
+    (uint8_t* dst, const uint8_t* src, size_t n, size_t size) {
+  size_t i = 0, step = XPACKET_VECTOR / size;
+  /* size is a constant, so only one loop is left */
+  if (size == 2)
+    for (; i + step <= n; i += step)
+      XPACKET_VSTORE(dst + 2 * i, XPACKET_VSWAP_2(XPACKET_VLOAD(src + 2 * i)));
+  else if (size == 4)
+    for (; i + step <= n; i += step)
+      XPACKET_VSTORE(dst + 4 * i, XPACKET_VSWAP_4(XPACKET_VLOAD(src + 4 * i)));
+  else if (size == 8)
+    for (; i + step <= n; i += step)
+      XPACKET_VSTORE(dst + 8 * i, XPACKET_VSWAP_8(XPACKET_VLOAD(src + 8 * i)));
+  return i;
+}
+#endif
+/* arrays in the opposite byte order of a known host use the vectors */
+#if defined(XPACKET_VECTOR) && defined(XPACKET_HOST_LITTLE_ENDIAN)
+#define XPACKET_SWAP_BLOCKS_be xpacket_swap_blocks
+#else
+#define XPACKET_SWAP_BLOCKS_be(dst, src, n, size) 0
+#endif
+#if defined(XPACKET_VECTOR) && defined(XPACKET_HOST_BIG_ENDIAN)
+#define XPACKET_SWAP_BLOCKS_le xpacket_swap_blocks
+#else
+#define XPACKET_SWAP_BLOCKS_le(dst, src, n, size) 0
+#endif
+/* generate the functions for every supported type */
+XPACKET_CODEC_NATIVE(be, uint8_t, )
+XPACKET_CODEC_NATIVE(le, uint8_t, )
+XPACKET_CODEC_be(be, uint16_t, XPACKET_BSWAP16)
+XPACKET_CODEC_be(be, uint32_t, XPACKET_BSWAP32)
+XPACKET_CODEC_be(be, uint64_t, XPACKET_BSWAP64)
+XPACKET_CODEC_le(le, uint16_t, XPACKET_BSWAP16)
+XPACKET_CODEC_le(le, uint32_t, XPACKET_BSWAP32)
+XPACKET_CODEC_le(le, uint64_t, XPACKET_BSWAP64)
+XPACKET_CODEC_NATIVE(be, int8_t, )
+XPACKET_CODEC_NATIVE(le, int8_t, )
+XPACKET_CODEC_CAST_be(be, int16_t, uint16_t)
+XPACKET_CODEC_CAST_be(be, int32_t, uint32_t)
+XPACKET_CODEC_CAST_be(be, int64_t, uint64_t)
+XPACKET_CODEC_CAST_be(be, float, uint32_t)
+XPACKET_CODEC_CAST_be(be, double, uint64_t)
+XPACKET_CODEC_CAST_le(le, int16_t, uint16_t)
+XPACKET_CODEC_CAST_le(le, int32_t, uint32_t)
+XPACKET_CODEC_CAST_le(le, int64_t, uint64_t)
+XPACKET_CODEC_CAST_le(le, float, uint32_t)
+XPACKET_CODEC_CAST_le(le, double, uint64_t)
+/**
+ * \brief        Serialize a varint (LEB128, 7 bits per byte, LSB first).
+ * \param pl     Payload memory address.
+ * \param v      Value that will be serialized.
+ * \return       Number of bytes serialized.
+ */
+static inline uint8_t xpacket_put_varint(uint8_t* pl, uint32_t v) {
+  uint8_t n = 0;
+  while (v >= 0x80) {
+    pl[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  pl[n++] = (uint8_t)v;
+  return n;
+}
+/**
+ * \brief        Number of bytes of a serialized varint.
+ * \param v      Value that will be serialized.
+ * \return       Number of bytes.
+ */
+static inline uint8_t xpacket_size_varint(uint32_t v) {
+  uint8_t n = 1;
+  while (v >= 0x80) {
+    n++;
+    v >>= 7;
+  }
+  return n;
+}
+/**
+ * \brief        Deserialize a varint.
+ * \param pl     Payload memory address.
+ * \param max    Maximum number of bytes that can be read.
+ * \param v      Pointer where the value will be saved.
+ * \return       Number of bytes deserialized, 0 if varint is not terminated.
+ *
+ *    Every byte is accumulated without branches on its position: the loop
+ *    only stops at the first byte without continuation bit, so the compiler
+ *    can fully unroll it ("max" is a constant in the unchecked functions).
+ */
+static inline uint8_t xpacket_get_varint
+    (const uint8_t* pl, uint8_t max, uint32_t* v) {
+  uint32_t r = 0;
+  uint8_t i;
+  for (i = 0; i < max; i++) {
+    r |= (uint32_t)(pl[i] & 0x7f) << (7 * i);
+    if (!(pl[i] & 0x80)) break;
+  }
+  *v = r;
+  return i < max ? i + 1 : 0;
+}
+/**
+ * \brief        Check that a deserialized varint fits its type.
+ * \param pl     Payload memory address.
+ * \param n      Number of bytes deserialized (0 if not terminated).
+ * \param v      Value deserialized.
+ * \param bits   Number of bits of the type (at most 32).
+ * \return       1 if valid, 0 if the value or the encoding is too long.
+ *
+ *    The encoding can take at most ceil(bits/7) bytes, and the last one of
+ *    a 32-bit value (the 5th) can hold only its 4 highest bits.
+ */
+static inline uint8_t xpacket_check_varint
+    (const uint8_t* pl, uint8_t n, uint32_t v, uint8_t bits) {
+  return n > 0 && n <= (bits + 6) / 7 && (bits >= 32 || v >> bits == 0) &&
+    (n < 5 || pl[4] >> (bits - 28) == 0);
+}
+/**
+ * \brief        Serialize a bit field (most significant bit first).
+ * \param pl     Payload memory address (byte holding the first bit).
+ * \param bit    Position of the first bit in that byte (0 is the MSB).
+ * \param nbits  Number of bits (at most 32).
+ * \param v      Value that will be serialized (only its lowest bits).
+ * \param clear  If not 0, the bytes entered from their first bit are
+ *               cleared, otherwise the other bits are preserved.
+ */
+static inline void xpacket_put_bits
+    (uint8_t* pl, uint8_t bit, uint8_t nbits, uint32_t v, uint8_t clear) {
+  while (nbits > 0) {
+    uint8_t n = 8 - bit < nbits ? 8 - bit : nbits; /* bits in this byte */
+    uint8_t shift = 8 - bit - n;
+    uint8_t mask = (uint8_t)(((1u << n) - 1) << shift);
+    nbits -= n;
+    if (clear && bit == 0) *pl = 0;
+    *pl = (uint8_t)((*pl & ~mask) | ((v >> nbits << shift) & mask));
+    pl++;
+    bit = 0;
+  }
+}
+/**
+ * \brief        Deserialize a bit field.
+ * \param pl     Payload memory address (byte holding the first bit).
+ * \param bit    Position of the first bit in that byte (0 is the MSB).
+ * \param nbits  Number of bits (at most 32).
+ * \return       Value deserialized.
+ */
+static inline uint32_t xpacket_get_bits
+    (const uint8_t* pl, uint8_t bit, uint8_t nbits) {
+  uint32_t v = 0;
+  while (nbits > 0) {
+    uint8_t n = 8 - bit < nbits ? 8 - bit : nbits; /* bits in this byte */
+    v = v << n | (uint32_t)((*pl >> (8 - bit - n)) & ((1u << n) - 1));
+    nbits -= n;
+    pl++;
+    bit = 0;
+  }
+  return v;
+}
+/* conversion of the values into varints: unsigned types are unchanged, */
+/* signed ones are zig-zag encoded (so small negative values are short) */
+#define XPACKET_VARINT_UNSIGNED(type) \
+  static inline uint32_t xpacket_varint_from_##type(type v) { \
+    return v; \
+  } \
+  static inline type xpacket_varint_to_##type(uint32_t v) { \
+    return (type)v; \
+  }
+#define XPACKET_VARINT_SIGNED(type) \
+  static inline uint32_t xpacket_varint_from_##type(type v) { \
+    return (uint32_t)v << 1 ^ (uint32_t)-(v < 0); \
+  } \
+  static inline type xpacket_varint_to_##type(uint32_t v) { \
+    return (v & 1) ? -(type)(v >> 1) - 1 : (type)(v >> 1); \
+  }
+XPACKET_VARINT_UNSIGNED(uint8_t)
+XPACKET_VARINT_UNSIGNED(uint16_t)
+XPACKET_VARINT_UNSIGNED(uint32_t)
+XPACKET_VARINT_SIGNED(int8_t)
+XPACKET_VARINT_SIGNED(int16_t)
+XPACKET_VARINT_SIGNED(int32_t)
+#endif /* XPACKET_COMMON */
+/* scatter-gather definitions, generated only once if enabled */
+#if defined(XPACKET_IOV) && !defined(XPACKET_COMMON_IOV)
+#define XPACKET_COMMON_IOV
+#include <sys/uio.h>
+/**
+ * \brief        Add a referenced buffer to the iovec entries.
+ * \param iov    Array of iovec entries.
+ * \param n      Number of entries already used.
+ * \param seg    Pending segment of the payload (before the buffer).
+ * \param seglen Length of the pending segment (can be 0).
+ * \param ref    Referenced buffer.
+ * \param reflen Length of the referenced buffer.
+ * \return       Number of entries used.
+ */
+static inline uint16_t xpacket_iov_add(struct iovec* iov, uint16_t n,
+    const uint8_t* seg, XPACKET_SIZE_TYPE seglen, const void* ref,
+    size_t reflen) {
+  if (seglen > 0) {
+    iov[n].iov_base = (void*)seg;
+    iov[n].iov_len = seglen;
+    n++;
+  }
+  iov[n].iov_base = (void*)ref;
+  iov[n].iov_len = reflen;
+  return n + 1;
+}
+/**
+ * \brief        Total length of the iovec entries.
+ * \param iov    Array of iovec entries.
+ * \param n      Number of entries.
+ * \return       Sum of their lengths.
+ */
+static inline size_t xpacket_iov_size(const struct iovec* iov, uint16_t n) {
+  size_t len = 0;
+  while (n > 0) len += iov[--n].iov_len;
+  return len;
+}
+#endif /* XPACKET_COMMON_IOV */
+/* arena definitions, generated only once if enabled */
+#if defined(XPACKET_ARENA) && !defined(XPACKET_COMMON_ARENA)
+#define XPACKET_COMMON_ARENA
+#include <stddef.h>
+/* bump allocator: "cap" bytes at "base", the first "used" are allocated */
+struct xpacket_arena {
+  uint8_t* base;
+  size_t used;
+  size_t cap;
+};
+/**
+ * \brief        Allocate memory from an arena.
+ * \param a      Arena.
+ * \param size   Number of bytes.
+ * \param align  Alignment (power of 2, relative to the arena base).
+ * \return       Memory address, or NULL if the arena is exhausted.
+ */
+static inline void* xpacket_arena_alloc
+    (struct xpacket_arena* a, size_t size, size_t align) {
+  size_t off = (a->used + align - 1) & ~(align - 1);
+  if (off > a->cap || size > a->cap - off) return NULL;
+  a->used = off + size;
+  return a->base + off;
+}
+#endif /* XPACKET_COMMON_ARENA */
+/* table-driven definitions, generated only once if enabled */
+#if defined(XPACKET_TABLE_DRIVEN) && !defined(XPACKET_COMMON_TABLE)
+#define XPACKET_COMMON_TABLE
+#include <stddef.h>
+/* kinds of field: the elements are in the structure, or pointed by it */
+enum { XPACKET_KIND_VALUE, XPACKET_KIND_POINTER };
+/* field descriptor */
+struct xpacket_field {
+  uint8_t kind;             /* XPACKET_KIND_VALUE or XPACKET_KIND_POINTER */
+  uint8_t size;             /* size of an element (1, 2, 4 or 8) */
+  XPACKET_SIZE_TYPE offset; /* offset of the field in the structure */
+  XPACKET_SIZE_TYPE dim;    /* number of elements */
+};
+/* a run of elements is copied, or converted through an integer type */
+#define XPACKET_TABLE_RUN(fn, dst, src, size, len, le, native) \
+  if (native) memcpy(dst, src, len); \
+  else switch (size) { \
+    case 2: XPACKET_TABLE_##fn(uint16_t, dst, src, len, le) break; \
+    case 4: XPACKET_TABLE_##fn(uint32_t, dst, src, len, le) break; \
+    case 8: XPACKET_TABLE_##fn(uint64_t, dst, src, len, le) break; \
+    default: memcpy(dst, src, len); \
+  }
+#define XPACKET_TABLE_put(type, dst, src, len, le) \
+  for (j = 0; j < (len); j += sizeof(type)) { \
+    type v; \
+    memcpy(&v, src + j, sizeof(type)); \
+    if (le) xpacket_put_le_##type(dst + j, v); \
+    else xpacket_put_be_##type(dst + j, v); \
+  }
+#define XPACKET_TABLE_get(type, dst, src, len, le) \
+  for (j = 0; j < (len); j += sizeof(type)) { \
+    type v = le ? xpacket_get_le_##type(src + j) : \
+      xpacket_get_be_##type(src + j); \
+    memcpy(dst + j, &v, sizeof(type)); \
+  }
+/* the following fields are merged in a run if they are contiguous in */
+/* the structure (and their elements have the same size, if converted) */
+#define XPACKET_TABLE_MERGE(f, i, n, size, len, native) \
+  while (i < n && f[i].kind == XPACKET_KIND_VALUE && \
+      f[i].offset == f[i - 1].offset + f[i - 1].size * f[i - 1].dim && \
+      (native || f[i].size == size)) { \
+    len += f[i].size * f[i].dim; \
+    i++; \
+  }
+/**
+ * \brief        Serialize a structure, interpreting its field descriptors.
+ * \param pl     Payload memory address.
+ * \param data   Pointer to the structure that will be serialized.
+ * \param f      Field descriptors.
+ * \param n      Number of field descriptors.
+ * \param le     If not 0, little-endian byte order is used.
+ * \param native If not 0, the byte order is the host one.
+ * \return       Number of bytes serialized.
+ */
+static inline XPACKET_SIZE_TYPE xpacket_table_serialize(uint8_t* pl,
+    const void* data, const struct xpacket_field* f, uint16_t n, uint8_t le,
+    uint8_t native) {
+  XPACKET_SIZE_TYPE idx = 0, j;
+  uint16_t i = 0;
+  while (i < n) {
+    const uint8_t* src = (const uint8_t*)data + f[i].offset;
+    uint8_t size = f[i].size;
+    XPACKET_SIZE_TYPE len = f[i].size * f[i].dim; /* bytes of the run */
+    if (f[i++].kind == XPACKET_KIND_POINTER) memcpy(&src, src, sizeof(src));
+    else XPACKET_TABLE_MERGE(f, i, n, size, len, native)
+    XPACKET_TABLE_RUN(put, pl + idx, src, size, len, le, native)
+    idx += len;
+  }
+  return idx;
+}
+/**
+ * \brief        Deserialize a structure, interpreting its field descriptors.
+ * \param pl     Payload memory address.
+ * \param data   Pointer to the structure where values will be saved.
+ * \param f      Field descriptors.
+ * \param n      Number of field descriptors.
+ * \param le     If not 0, little-endian byte order is used.
+ * \param native If not 0, the byte order is the host one.
+ * \return       Number of bytes deserialized.
+ */
+static inline XPACKET_SIZE_TYPE xpacket_table_deserialize(const uint8_t* pl,
+    void* data, const struct xpacket_field* f, uint16_t n, uint8_t le,
+    uint8_t native) {
+  XPACKET_SIZE_TYPE idx = 0, j;
+  uint16_t i = 0;
+  while (i < n) {
+    uint8_t* dst = (uint8_t*)data + f[i].offset;
+    uint8_t size = f[i].size;
+    XPACKET_SIZE_TYPE len = f[i].size * f[i].dim; /* bytes of the run */
+    if (f[i++].kind == XPACKET_KIND_POINTER) memcpy(&dst, dst, sizeof(dst));
+    else XPACKET_TABLE_MERGE(f, i, n, size, len, native)
+    XPACKET_TABLE_RUN(get, dst, pl + idx, size, len, le, native)
+    idx += len;
+  }
+  return idx;
+}
+#endif /* XPACKET_COMMON_TABLE */
+/* delta definitions, generated only once if enabled */
+#if defined(XPACKET_DELTA) && !defined(XPACKET_COMMON_DELTA)
+#define XPACKET_COMMON_DELTA
+/**
+ * \brief        Mark a field in the presence bitmap, if it is changed.
+ * \param map    Presence bitmap (a bit for every field, MSB first).
+ * \param f      Index of the field.
+ * \param diff   If not 0, the field is changed.
+ * \return       The "diff" argument.
+ */
+static inline int xpacket_delta_mark(uint8_t* map, uint16_t f, int diff) {
+  if (diff) map[f / 8] |= (uint8_t)(0x80 >> f % 8);
+  return diff;
+}
+/**
+ * \brief        Check if a field is present in the bitmap.
+ * \param map    Presence bitmap.
+ * \param f      Index of the field.
+ * \return       Not 0 if the field is present.
+ */
+static inline int xpacket_delta_test(const uint8_t* map, uint16_t f) {
+  return map[f / 8] & (0x80 >> f % 8);
+}
+#endif /* XPACKET_COMMON_DELTA */
+/* checksum definitions, generated only once if enabled */
+#if defined(XPACKET_CHECKSUM) && !defined(XPACKET_COMMON_CHECKSUM)
+#define XPACKET_COMMON_CHECKSUM
+#include <stddef.h>
+/* CRC32C (Castagnoli) instructions, if the target has them: 8 bytes at once */
+#if !defined(XPACKET_PORTABLE) && \
+    (defined(__SSE4_2__) || (defined(_MSC_VER) && defined(__AVX__)))
+#include <nmmintrin.h>
+#if defined(__x86_64__) || defined(_M_X64)
+#define XPACKET_CRC32C_WORD(crc, w) ((uint32_t)_mm_crc32_u64(crc, w))
+#else
+#define XPACKET_CRC32C_WORD(crc, w) \
+  _mm_crc32_u32(_mm_crc32_u32(crc, (uint32_t)(w)), (uint32_t)((w) >> 32))
+#endif
+#define XPACKET_CRC32C_BYTE(crc, b) _mm_crc32_u8(crc, b)
+#elif defined(__ARM_FEATURE_CRC32) && defined(XPACKET_HOST_LITTLE_ENDIAN)
+#include <arm_acle.h>
+#define XPACKET_CRC32C_WORD(crc, w) __crc32cd(crc, w)
+#define XPACKET_CRC32C_BYTE(crc, b) __crc32cb(crc, b)
+#else
+/* otherwise a byte at a time, with the table of the reflected polynomial */
+static const uint32_t xpacket_crc32c_table[256] = {
+  0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c,
+  0x26a1e7e8, 0xd4ca64eb, 0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b,
+  0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24, 0x105ec76f, 0xe235446c,
+  0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+  0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc,
+  0xbc267848, 0x4e4dfb4b, 0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a,
+  0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35, 0xaa64d611, 0x580f5512,
+  0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+  0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad,
+  0x1642ae59, 0xe4292d5a, 0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a,
+  0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595, 0x417b1dbc, 0xb3109ebf,
+  0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+  0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f,
+  0xed03a29b, 0x1f682198, 0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927,
+  0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38, 0xdbfc821c, 0x2997011f,
+  0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+  0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e,
+  0x4767748a, 0xb50cf789, 0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859,
+  0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46, 0x7198540d, 0x83f3d70e,
+  0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+  0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de,
+  0xdde0eb2a, 0x2f8b6829, 0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c,
+  0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93, 0x082f63b7, 0xfa44e0b4,
+  0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+  0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b,
+  0xb4091bff, 0x466298fc, 0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c,
+  0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033, 0xa24bb5a6, 0x502036a5,
+  0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+  0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975,
+  0x0e330a81, 0xfc588982, 0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d,
+  0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622, 0x38cc2a06, 0xcaa7a905,
+  0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+  0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8,
+  0xe52cc12c, 0x1747422f, 0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff,
+  0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0, 0xd3d3e1ab, 0x21b862a8,
+  0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+  0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78,
+  0x7fab5e8c, 0x8dc0dd8f, 0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee,
+  0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1, 0x69e9f0d5, 0x9b8273d6,
+  0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+  0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69,
+  0xd5cf889d, 0x27a40b9e, 0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e,
+  0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351
+};
+#define XPACKET_CRC32C_BYTE(crc, b) \
+  (xpacket_crc32c_table[((crc) ^ (b)) & 0xff] ^ ((crc) >> 8))
+#endif
+/**
+ * \brief        Compute the CRC32C of a memory region.
+ * \param crc    CRC32C of the previous regions (0 for the first one).
+ * \param p      Memory address.
+ * \param n      Number of bytes.
+ * \return       CRC32C of all the regions, in order.
+ */
+static inline uint32_t xpacket_crc32c
+    (uint32_t crc, const uint8_t* p, size_t n) {
+  crc = ~crc;
+  #ifdef XPACKET_CRC32C_WORD
+  for (; n >= 8; n -= 8, p += 8) {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    crc = XPACKET_CRC32C_WORD(crc, w);
+  }
+  #endif
+  for (; n > 0; n--, p++) crc = XPACKET_CRC32C_BYTE(crc, *p);
+  return ~crc;
+}
+#endif /* XPACKET_COMMON_CHECKSUM */
+/*---------------------------------------------------------------------------*/
 /* define overloading for macros (valid until the end of the file) */
 /* TODO check/stop if there are more arguments than needed */
 #define OVERLOAD_FIELD(_1, _2, _3, name, ...) name
@@ -114,10 +1007,28 @@
     FIELD_PTR_ARRAY, FIELD_PTR_VAR, FIELD_ERROR)(__VA_ARGS__)
 /*---------------------------------------------------------------------------*/
 /* check if fields are well formed */
-/* supported types must be set to 1 */
+/* supported types must be set to a distinct non-zero code (see SCHEMA_ID) */
 #define XPACKET_TYPE_uint8_t  1
-#define XPACKET_TYPE_uint16_t 1
-#define XPACKET_TYPE_uint32_t 1
+#define XPACKET_TYPE_uint16_t 2
+#define XPACKET_TYPE_uint32_t 3
+#define XPACKET_TYPE_uint64_t 4
+#define XPACKET_TYPE_int8_t   5
+#define XPACKET_TYPE_int16_t  6
+#define XPACKET_TYPE_int32_t  7
+#define XPACKET_TYPE_int64_t  8
+#define XPACKET_TYPE_float    9
+#define XPACKET_TYPE_double   10
+/* supported varint types must be set to 1 */
+#define XPACKET_VARINT_uint8_t  1
+#define XPACKET_VARINT_uint16_t 1
+#define XPACKET_VARINT_uint32_t 1
+#define XPACKET_VARINT_int8_t   1
+#define XPACKET_VARINT_int16_t  1
+#define XPACKET_VARINT_int32_t  1
+/* supported bit field types must be set to their number of bits */
+#define XPACKET_BITS_uint8_t  8
+#define XPACKET_BITS_uint16_t 16
+#define XPACKET_BITS_uint32_t 32
 /* auxiliary macro for checking if a given macro argument is null or not */
 #define TRUE 1
 /* names must be not null, types are converted into the corresponding macro, */
@@ -129,25 +1040,47 @@
 #define FIELD_PTR_VAR(type, name) !(TRUE##name) && XPACKET_TYPE_##type &&
 #define FIELD_PTR_ARRAY(type, name, dim) \
   !(TRUE##name) && XPACKET_TYPE_##type && (dim > 0) &&
+#define FIELD_VARRAY(type, name, maxdim, lenfield) \
+  !(TRUE##name) && XPACKET_TYPE_##type && (maxdim > 0) && !(TRUE##lenfield) &&
+#define FIELD_VARINT(type, name) !(TRUE##name) && XPACKET_VARINT_##type &&
+#define FIELD_BITS(type, name, nbits) \
+  !(TRUE##name) && (nbits > 0) && (nbits <= XPACKET_BITS_##type) &&
 #define FIELD_CUSTOM(type, name, ser, de) \
   !(TRUE##type) && !(TRUE##name) && !(TRUE##ser) &&!(TRUE##de) &&
+#define FIELD_HOOK(type, name, ser, de) \
+  !(TRUE##type) && !(TRUE##name) && !(TRUE##ser) &&!(TRUE##de) &&
 /* substitution and evaluation (an undefined macro is considered 0) */
 #if !(XPACKET_STRUCT 1)
 /* define a macro (see later) and report the error */
 #define XPACKET_BAD_FORMAT
 #error "XPacket - Bad format"
 #endif
+/* the identifier is the first byte of a frame (see xpacket_dispatch.h) */
+#if defined(XPACKET_ID) && (XPACKET_ID < 0 || XPACKET_ID > 255)
+#define XPACKET_BAD_FORMAT
+#error "XPacket - XPACKET_ID out of range"
+#endif
 /* undefine various macros */
 #undef FIELD_ERROR
 #undef FIELD_VAR
 #undef FIELD_ARRAY
 #undef FIELD_PTR_VAR
 #undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
 #undef FIELD_CUSTOM
+#undef FIELD_HOOK
 #undef TRUE
-#undef XPACKET_TYPE_uint8_t
-#undef XPACKET_TYPE_uint16_t
-#undef XPACKET_TYPE_uint32_t
+#undef XPACKET_VARINT_uint8_t
+#undef XPACKET_VARINT_uint16_t
+#undef XPACKET_VARINT_uint32_t
+#undef XPACKET_VARINT_int8_t
+#undef XPACKET_VARINT_int16_t
+#undef XPACKET_VARINT_int32_t
+#undef XPACKET_BITS_uint8_t
+#undef XPACKET_BITS_uint16_t
+#undef XPACKET_BITS_uint32_t
 /* if BAD_FORMAT is defined, do not proceed; endif is at the end of the file */
 #ifndef XPACKET_BAD_FORMAT
 /*---------------------------------------------------------------------------*/
@@ -157,14 +1090,87 @@ struct XPACKET_NAME {
   #define FIELD_ARRAY(type, name, dim)      type name[dim];
   #define FIELD_PTR_VAR(type, name)         type* name;
   #define FIELD_PTR_ARRAY(type, name, dim)  type* name;
+  #define FIELD_VARRAY(type, name, maxdim, lenfield) type name[maxdim];
+  #define FIELD_VARINT(type, name)          type name;
+  #define FIELD_BITS(type, name, nbits)     type name;
   #define FIELD_CUSTOM(type, name, ser, de) type name;
+  #define FIELD_HOOK(type, name, ser, de)   type name;
   XPACKET_STRUCT
   #undef FIELD_VAR
   #undef FIELD_ARRAY
   #undef FIELD_PTR_VAR
   #undef FIELD_PTR_ARRAY
+  #undef FIELD_VARRAY
+  #undef FIELD_VARINT
+  #undef FIELD_BITS
   #undef FIELD_CUSTOM
+  #undef FIELD_HOOK
 };
+/* probes of the layout: the fields expand to the PROBE_ macros, redefined */
+/* for every probe (each probe is still a substitution of all the fields) */
+#define FIELD_VAR(type, name)
+#define FIELD_ARRAY(type, name, dim)
+#define FIELD_PTR_VAR(type, name)
+#define FIELD_PTR_ARRAY(type, name, dim)
+#define FIELD_VARRAY(type, name, maxdim, lenfield) PROBE_VARIABLE
+#define FIELD_VARINT(type, name)          PROBE_VARIABLE
+#define FIELD_BITS(type, name, nbits)     PROBE_BITS
+#define FIELD_CUSTOM(type, name, ser, de) PROBE_CUSTOM
+#define FIELD_HOOK(type, name, ser, de)   PROBE_VARIABLE
+/* check if the packet has a fixed layout (no fields of variable size) */
+#define PROBE_VARIABLE 1 ||
+#define PROBE_BITS
+#define PROBE_CUSTOM 1 ||
+#if !(XPACKET_STRUCT 0)
+#define XPACKET_FIXED_LAYOUT
+#endif
+#undef PROBE_VARIABLE
+#undef PROBE_BITS
+#undef PROBE_CUSTOM
+/* check if the packet has bit fields (only for the definitions and the */
+/* column readers, so the files only declaring the packet skip it) */
+#define PROBE_VARIABLE
+#define PROBE_BITS 1 ||
+#define PROBE_CUSTOM
+#if (defined(XPACKET_C) || defined(XPACKET_COLUMNS)) && (XPACKET_STRUCT 0)
+#define XPACKET_BIT_FIELDS
+#endif
+#undef PROBE_BITS
+/* check if the packet has FIELD_CUSTOM fields (only if layout is variable), */
+/* whose functions cannot be bounds-checked */
+#define PROBE_BITS
+#undef PROBE_CUSTOM
+#define PROBE_CUSTOM 1 ||
+#if !defined(XPACKET_FIXED_LAYOUT) && (XPACKET_STRUCT 0)
+#define XPACKET_CUSTOM_FIELDS
+#endif
+#undef PROBE_VARIABLE
+#undef PROBE_BITS
+#undef PROBE_CUSTOM
+/* table-driven (de)serialization, only for the fixed layouts without bits */
+#if defined(XPACKET_TABLE_DRIVEN) && defined(XPACKET_FIXED_LAYOUT) && \
+    !defined(XPACKET_BIT_FIELDS)
+#define XPACKET_TABLE_LAYOUT
+#endif
+/* columnar batch layout, only for the fixed layouts without bits */
+#if defined(XPACKET_COLUMNS) && defined(XPACKET_FIXED_LAYOUT) && \
+    !defined(XPACKET_BIT_FIELDS)
+#define XPACKET_COLUMN_LAYOUT
+#endif
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+/* constant naming (always prefixed by the packet name) */
+#define CONSTANT(name, suffix) CONSTANT_AUX(name, suffix)
+#define CONSTANT_AUX(name, suffix) name##_##suffix
+/* field accessor naming (always prefixed by the packet name) */
+#define ACCESSOR(prefix, field) CONSTANT(XPACKET_NAME, prefix##_##field)
 /* function naming */
 #ifndef XPACKET_OVERLOADING
 #define METHOD(prefix, name) METHOD_AUX(prefix, name)
@@ -172,141 +1178,1302 @@ struct XPACKET_NAME {
 #else
 #define METHOD(prefix, name) prefix
 #endif
+/* function linkage (static inline, so they can be inlined in the caller) */
+#ifdef XPACKET_INLINE
+#define LINKAGE static inline
+#else
+#define LINKAGE
+#endif
+/* byte order of the serialized data (big-endian by default) */
+#ifndef XPACKET_LITTLE_ENDIAN
+#define CODEC(fn, type) CODEC_AUX(fn, be, type)
+#else
+#define CODEC(fn, type) CODEC_AUX(fn, le, type)
+#endif
+#define CODEC_AUX(fn, order, type) xpacket_##fn##_##order##_##type
+/* 1 if the serialized data have the host byte order (so they are copied) */
+#if (!defined(XPACKET_LITTLE_ENDIAN) && defined(XPACKET_HOST_BIG_ENDIAN)) || \
+    (defined(XPACKET_LITTLE_ENDIAN) && defined(XPACKET_HOST_LITTLE_ENDIAN))
+#define NATIVE_ORDER 1
+#else
+#define NATIVE_ORDER 0
+#endif
+/* expansion of the fields that precede the first one of variable size: */
+/* variable fields must be defined as FIXED_PREFIX_END, that "eats" the rest */
+#ifdef XPACKET_FIXED_LAYOUT
+#define FIXED_PREFIX XPACKET_STRUCT
+#else
+#define FIXED_PREFIX XPACKET_STRUCT )
+#endif
+#define FIXED_PREFIX_END(...) FIXED_PREFIX_EAT(
+#define FIXED_PREFIX_EAT(...)
+/* the schema identifier (uint32_t) can precede the fields in the payload */
+#ifdef XPACKET_SCHEMA_PREFIX
+#define SCHEMA_SIZE 4
+#else
+#define SCHEMA_SIZE 0
+#endif
+/* the checksum (uint32_t) can follow the fields in the payload */
+#ifdef XPACKET_CHECKSUM
+#define CHECKSUM_SIZE 4
+#else
+#define CHECKSUM_SIZE 0
+#endif
+/* columnar batch: the column of a field holds its values for all the _n */
+/* records, and begins where the records before the field end */
+#define COLUMN(name) \
+  (_n * (CONSTANT(XPACKET_NAME, OFF_##name) - SCHEMA_SIZE))
+/*---------------------------------------------------------------------------*/
+/* schema fingerprint: FNV-1a hash (modulo 2^31 - 1, to fit in an */
+/* enumerator) of the kind, type and size of every field, in order; the */
+/* hash is carried to the next field as the enumerator incremented */
+#define FOLD(h, v) ((((unsigned long long)(h) ^ (unsigned long long)(v)) \
+  * 16777619u) % 2147483647u)
+#define SCHEMA(name, kind, code, dim) \
+  CONSTANT(XPACKET_NAME, name##_FOLD_), \
+  CONSTANT(XPACKET_NAME, name##_SCHEMA_) = FOLD(FOLD(FOLD( \
+    CONSTANT(XPACKET_NAME, name##_FOLD_) - 1, kind), code), dim),
+enum {
+  #ifdef XPACKET_LITTLE_ENDIAN
+  CONSTANT(XPACKET_NAME, SCHEMA_BASIS_) = FOLD(2166136261u, 1),
+  #else
+  CONSTANT(XPACKET_NAME, SCHEMA_BASIS_) = FOLD(2166136261u, 0),
+  #endif
+  /* the fields with the same wire format have the same kind */
+  #define FIELD_VAR(type, name) SCHEMA(name, 1, XPACKET_TYPE_##type, 1)
+  #define FIELD_ARRAY(type, name, dim) \
+    SCHEMA(name, 1, XPACKET_TYPE_##type, dim)
+  #define FIELD_PTR_VAR(type, name)         FIELD_VAR(type, name)
+  #define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+  #define FIELD_VARRAY(type, name, maxdim, lenfield) \
+    SCHEMA(name, 2, XPACKET_TYPE_##type, maxdim)
+  #define FIELD_VARINT(type, name) SCHEMA(name, 3, XPACKET_TYPE_##type, 1)
+  #define FIELD_BITS(type, name, nbits) \
+    SCHEMA(name, 4, XPACKET_TYPE_##type, nbits)
+  #define FIELD_CUSTOM(type, name, ser, de) SCHEMA(name, 5, sizeof(type), 1)
+  #define FIELD_HOOK(type, name, ser, de) SCHEMA(name, 5, sizeof(type), 1)
+  XPACKET_STRUCT
+  #undef FIELD_VAR
+  #undef FIELD_ARRAY
+  #undef FIELD_PTR_VAR
+  #undef FIELD_PTR_ARRAY
+  #undef FIELD_VARRAY
+  #undef FIELD_VARINT
+  #undef FIELD_BITS
+  #undef FIELD_CUSTOM
+  #undef FIELD_HOOK
+  CONSTANT(XPACKET_NAME, SCHEMA_END_),
+  CONSTANT(XPACKET_NAME, SCHEMA_ID) = CONSTANT(XPACKET_NAME, SCHEMA_END_) - 1
+};
+#undef FOLD
+#undef SCHEMA
+/*---------------------------------------------------------------------------*/
+/* compile-time checks of the ranges (a negative array size fails): every */
+/* dimension must fit the sizes, and the offsets below (counted in bits, */
+/* bounded rounding every field up to the next byte) must fit an int */
+#define FIELD_VAR(type, name)
+#define FIELD_ARRAY(type, name, dim)      && (dim) <= XPACKET_SIZE_MAX
+#define FIELD_PTR_VAR(type, name)
+#define FIELD_PTR_ARRAY(type, name, dim)  && (dim) <= XPACKET_SIZE_MAX
+#define FIELD_VARRAY(type, name, maxdim, lenfield) \
+  && (maxdim) <= XPACKET_SIZE_MAX
+#define FIELD_VARINT(type, name)
+#define FIELD_BITS(type, name, nbits)
+#define FIELD_CUSTOM(type, name, ser, de)
+#define FIELD_HOOK(type, name, ser, de)
+typedef char CONSTANT(XPACKET_NAME, CHECK_DIM_)[(1 XPACKET_STRUCT) ? 1 : -1];
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+#define FIELD_VAR(type, name)             + 8ull * sizeof(type) + 7
+#define FIELD_ARRAY(type, name, dim)      + 8ull * sizeof(type) * (dim) + 7
+#define FIELD_PTR_VAR(type, name)         FIELD_VAR(type, name)
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+#define FIELD_VARRAY                      FIXED_PREFIX_END
+#define FIELD_VARINT                      FIXED_PREFIX_END
+#define FIELD_BITS(type, name, nbits)     + (nbits)
+#define FIELD_CUSTOM                      FIXED_PREFIX_END
+#define FIELD_HOOK                        FIXED_PREFIX_END
+typedef char CONSTANT(XPACKET_NAME, CHECK_BIT_)
+  [(SCHEMA_SIZE * 8ull FIXED_PREFIX + 7 <= INT_MAX) ? 1 : -1];
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+/*---------------------------------------------------------------------------*/
+/* offsets of the fields in the payload: the enumerators count the bits, */
+/* so every field begins right after the last bit of the previous one */
+/* (rounded up to the next byte, except for the consecutive bit fields) */
+#define OFFSET_BYTES(name, size) \
+  CONSTANT(XPACKET_NAME, name##_BEGIN_), \
+  CONSTANT(XPACKET_NAME, OFF_##name) = \
+    (CONSTANT(XPACKET_NAME, name##_BEGIN_) + 7) / 8, \
+  CONSTANT(XPACKET_NAME, name##_LAST_) = \
+    (CONSTANT(XPACKET_NAME, OFF_##name) + (size)) * 8 - 1,
+enum {
+  CONSTANT(XPACKET_NAME, BIT_BEGIN_) = SCHEMA_SIZE * 8 - 1,
+  #define FIELD_VAR(type, name)             OFFSET_BYTES(name, sizeof(type))
+  #define FIELD_ARRAY(type, name, dim) \
+    OFFSET_BYTES(name, sizeof(type) * (dim))
+  #define FIELD_PTR_VAR(type, name)         FIELD_VAR(type, name)
+  #define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+  #define FIELD_VARRAY                      FIXED_PREFIX_END
+  #define FIELD_VARINT                      FIXED_PREFIX_END
+  #define FIELD_BITS(type, name, nbits) \
+    CONSTANT(XPACKET_NAME, BIT_##name), \
+    CONSTANT(XPACKET_NAME, OFF_##name) = \
+      CONSTANT(XPACKET_NAME, BIT_##name) / 8, \
+    CONSTANT(XPACKET_NAME, name##_LAST_) = \
+      CONSTANT(XPACKET_NAME, BIT_##name) + (nbits) - 1,
+  #define FIELD_CUSTOM                      FIXED_PREFIX_END
+  #define FIELD_HOOK                        FIXED_PREFIX_END
+  FIXED_PREFIX
+  #undef FIELD_VAR
+  #undef FIELD_ARRAY
+  #undef FIELD_PTR_VAR
+  #undef FIELD_PTR_ARRAY
+  #undef FIELD_VARRAY
+  #undef FIELD_VARINT
+  #undef FIELD_BITS
+  #undef FIELD_CUSTOM
+  #undef FIELD_HOOK
+  CONSTANT(XPACKET_NAME, BIT_END_)
+};
+#undef OFFSET_BYTES
+/* size of the serialized packet, known at compile time if layout is fixed */
+#ifdef XPACKET_FIXED_LAYOUT
+enum {
+  CONSTANT(XPACKET_NAME, WIRE_SIZE) =
+    (CONSTANT(XPACKET_NAME, BIT_END_) + 7) / 8 + CHECKSUM_SIZE
+};
+#endif
+/* views: read/write a field directly in the payload, without (de)serialize */
+/* the whole packet (only for the fields before the first variable one) */
+#define FIELD_VAR(type, name) \
+  static inline type ACCESSOR(get, name)(const uint8_t* _pl) { \
+    return CODEC(get, type)(_pl + CONSTANT(XPACKET_NAME, OFF_##name)); \
+  } \
+  static inline void ACCESSOR(set, name)(uint8_t* _pl, type _v) { \
+    CODEC(put, type)(_pl + CONSTANT(XPACKET_NAME, OFF_##name), _v); \
+  }
+#define FIELD_ARRAY(type, name, dim) \
+  static inline type ACCESSOR(get, name) \
+      (const uint8_t* _pl, XPACKET_SIZE_TYPE _i) { \
+    return CODEC(get, type) \
+      (_pl + CONSTANT(XPACKET_NAME, OFF_##name) + sizeof(type) * _i); \
+  } \
+  static inline void ACCESSOR(set, name) \
+      (uint8_t* _pl, XPACKET_SIZE_TYPE _i, type _v) { \
+    CODEC(put, type) \
+      (_pl + CONSTANT(XPACKET_NAME, OFF_##name) + sizeof(type) * _i, _v); \
+  }
+#define FIELD_PTR_VAR(type, name)         FIELD_VAR(type, name)
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+#define FIELD_VARRAY                      FIXED_PREFIX_END
+#define FIELD_VARINT                      FIXED_PREFIX_END
+/* the other bits of the bytes are preserved */
+#define FIELD_BITS(type, name, nbits) \
+  static inline type ACCESSOR(get, name)(const uint8_t* _pl) { \
+    return (type)xpacket_get_bits(_pl + CONSTANT(XPACKET_NAME, OFF_##name), \
+      CONSTANT(XPACKET_NAME, BIT_##name) % 8, nbits); \
+  } \
+  static inline void ACCESSOR(set, name)(uint8_t* _pl, type _v) { \
+    xpacket_put_bits(_pl + CONSTANT(XPACKET_NAME, OFF_##name), \
+      CONSTANT(XPACKET_NAME, BIT_##name) % 8, nbits, _v, 0); \
+  }
+#define FIELD_CUSTOM                      FIXED_PREFIX_END
+#define FIELD_HOOK                        FIXED_PREFIX_END
+FIXED_PREFIX
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+#ifdef XPACKET_COLUMN_LAYOUT
+/* column readers: decode a single column, without reading the others */
+#define FIELD_VAR(type, name) \
+  static inline void ACCESSOR(get_column, name) \
+      (const uint8_t* _in, size_t _n, type* _out) { \
+    size_t _i; \
+    for (_i = 0; _i < _n; _i++) \
+      _out[_i] = CODEC(get, type)(_in + COLUMN(name) + sizeof(type) * _i); \
+  }
+#define FIELD_ARRAY(type, name, dim) \
+  static inline void ACCESSOR(get_column, name) \
+      (const uint8_t* _in, size_t _n, type* _out) { \
+    size_t _i; \
+    for (_i = 0; _i < _n; _i++) \
+      CODEC(get_array, type)(_in + COLUMN(name) + sizeof(type) * (dim) * _i, \
+        _out + (dim) * _i, dim); \
+  }
+#define FIELD_PTR_VAR(type, name)         FIELD_VAR(type, name)
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+XPACKET_STRUCT
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#endif
 /* function declaration */
-uint16_t METHOD(serialize, XPACKET_NAME)(uint8_t*, const struct XPACKET_NAME*);
-uint16_t METHOD(deserialize, XPACKET_NAME)(const uint8_t*, struct XPACKET_NAME*);
+LINKAGE XPACKET_SIZE_TYPE METHOD(serialize, XPACKET_NAME)
+  (uint8_t*, const struct XPACKET_NAME*);
+LINKAGE XPACKET_SIZE_TYPE METHOD(deserialize, XPACKET_NAME)
+  (const uint8_t*, struct XPACKET_NAME*);
+#ifndef XPACKET_CUSTOM_FIELDS
+LINKAGE XPACKET_SIZE_TYPE METHOD(serialize_n, XPACKET_NAME)
+  (uint8_t*, XPACKET_SIZE_TYPE, const struct XPACKET_NAME*);
+LINKAGE XPACKET_SIZE_TYPE METHOD(deserialize_n, XPACKET_NAME)
+  (const uint8_t*, XPACKET_SIZE_TYPE, struct XPACKET_NAME*);
+#endif
+#ifdef XPACKET_FIXED_LAYOUT
+LINKAGE size_t METHOD(serialize_batch, XPACKET_NAME)
+  (uint8_t*, const struct XPACKET_NAME*, size_t);
+LINKAGE size_t METHOD(deserialize_batch, XPACKET_NAME)
+  (const uint8_t*, struct XPACKET_NAME*, size_t);
+/* state of the streaming deserialization (must be zero-initialized) */
+struct CONSTANT(XPACKET_NAME, decoder) {
+  XPACKET_SIZE_TYPE pos; /* bytes of the current packet already fed */
+  uint8_t buf[CONSTANT(XPACKET_NAME, WIRE_SIZE)]; /* incomplete fields */
+};
+LINKAGE size_t METHOD(feed, XPACKET_NAME)
+  (struct CONSTANT(XPACKET_NAME, decoder)*, struct XPACKET_NAME*,
+  const uint8_t*, size_t);
+#endif
+#if defined(XPACKET_ARENA) && !defined(XPACKET_CUSTOM_FIELDS)
+LINKAGE XPACKET_SIZE_TYPE METHOD(deserialize_arena, XPACKET_NAME)
+  (const uint8_t*, XPACKET_SIZE_TYPE, struct XPACKET_NAME*,
+  struct xpacket_arena*);
+#endif
+#ifdef XPACKET_IOV
+/* maximum number of iovec entries: FIELD_PTR_ARRAY and previous segment */
+enum {
+  #define FIELD_VAR(type, name)
+  #define FIELD_ARRAY(type, name, dim)
+  #define FIELD_PTR_VAR(type, name)
+  #define FIELD_PTR_ARRAY(type, name, dim)  2 +
+  #define FIELD_VARRAY(type, name, maxdim, lenfield)
+  #define FIELD_VARINT(type, name)
+  #define FIELD_BITS(type, name, nbits)
+  #define FIELD_CUSTOM(type, name, ser, de)
+  #define FIELD_HOOK(type, name, ser, de)
+  CONSTANT(XPACKET_NAME, IOV_ENTRIES) = XPACKET_STRUCT 1
+  #undef FIELD_VAR
+  #undef FIELD_ARRAY
+  #undef FIELD_PTR_VAR
+  #undef FIELD_PTR_ARRAY
+  #undef FIELD_VARRAY
+  #undef FIELD_VARINT
+  #undef FIELD_BITS
+  #undef FIELD_CUSTOM
+  #undef FIELD_HOOK
+};
+LINKAGE uint16_t METHOD(serialize_iov, XPACKET_NAME)
+  (uint8_t*, struct iovec*, const struct XPACKET_NAME*);
+#endif
+#ifdef XPACKET_DELTA
+/* size of the presence bitmap of the delta encoding (a bit every field) */
+enum {
+  #define FIELD_VAR(type, name)             + 1
+  #define FIELD_ARRAY(type, name, dim)      + 1
+  #define FIELD_PTR_VAR(type, name)         + 1
+  #define FIELD_PTR_ARRAY(type, name, dim)  + 1
+  #define FIELD_VARRAY(type, name, maxdim, lenfield) + 1
+  #define FIELD_VARINT(type, name)          + 1
+  #define FIELD_BITS(type, name, nbits)     + 1
+  #define FIELD_CUSTOM(type, name, ser, de) + 1
+  #define FIELD_HOOK(type, name, ser, de)   + 1
+  CONSTANT(XPACKET_NAME, DELTA_MAP) = (XPACKET_STRUCT + 7) / 8
+  #undef FIELD_VAR
+  #undef FIELD_ARRAY
+  #undef FIELD_PTR_VAR
+  #undef FIELD_PTR_ARRAY
+  #undef FIELD_VARRAY
+  #undef FIELD_VARINT
+  #undef FIELD_BITS
+  #undef FIELD_CUSTOM
+  #undef FIELD_HOOK
+};
+LINKAGE XPACKET_SIZE_TYPE METHOD(serialize_delta, XPACKET_NAME)
+  (uint8_t*, const struct XPACKET_NAME*, const struct XPACKET_NAME*);
+LINKAGE XPACKET_SIZE_TYPE METHOD(deserialize_delta, XPACKET_NAME)
+  (const uint8_t*, struct XPACKET_NAME*);
+#endif
+#ifdef XPACKET_COLUMN_LAYOUT
+LINKAGE size_t METHOD(serialize_columns, XPACKET_NAME)
+  (uint8_t*, const struct XPACKET_NAME*, size_t);
+LINKAGE size_t METHOD(deserialize_columns, XPACKET_NAME)
+  (const uint8_t*, struct XPACKET_NAME*, size_t);
+#endif
+#ifdef XPACKET_ID
+/* registration of the packet in a dispatch table (see xpacket_dispatch.h): */
+/* its identifier, wire size (0 if variable) and type-erased deserialize_n */
+#ifdef XPACKET_CUSTOM_FIELDS
+#error "XPacket - FIELD_CUSTOM is not bounds-checked (use FIELD_HOOK)"
+#endif
+enum {
+  CONSTANT(XPACKET_NAME, ID) = XPACKET_ID,
+  #ifdef XPACKET_FIXED_LAYOUT
+  CONSTANT(XPACKET_NAME, FIXED_SIZE) = CONSTANT(XPACKET_NAME, WIRE_SIZE)
+  #else
+  CONSTANT(XPACKET_NAME, FIXED_SIZE) = 0
+  #endif
+};
+static inline XPACKET_SIZE_TYPE CONSTANT(XPACKET_NAME, deserialize_any)
+    (const uint8_t* _pl, XPACKET_SIZE_TYPE _len, void* _data) {
+  return METHOD(deserialize_n, XPACKET_NAME)
+    (_pl, _len, (struct XPACKET_NAME*)_data);
+}
+#endif
 /* function definition enabled only by the apposite macro */
 #ifdef XPACKET_C
 /*---------------------------------------------------------------------------*/
+#ifdef XPACKET_TABLE_LAYOUT
+/* field descriptors, interpreted by the table-driven functions */
+static const struct xpacket_field CONSTANT(XPACKET_NAME, fields_)[] = {
+  #define FIELD_VAR(type, name) { XPACKET_KIND_VALUE, sizeof(type), \
+    offsetof(struct XPACKET_NAME, name), 1 },
+  #define FIELD_ARRAY(type, name, dim) { XPACKET_KIND_VALUE, sizeof(type), \
+    offsetof(struct XPACKET_NAME, name), dim },
+  #define FIELD_PTR_VAR(type, name) { XPACKET_KIND_POINTER, sizeof(type), \
+    offsetof(struct XPACKET_NAME, name), 1 },
+  #define FIELD_PTR_ARRAY(type, name, dim) { XPACKET_KIND_POINTER, \
+    sizeof(type), offsetof(struct XPACKET_NAME, name), dim },
+  XPACKET_STRUCT
+  #undef FIELD_VAR
+  #undef FIELD_ARRAY
+  #undef FIELD_PTR_VAR
+  #undef FIELD_PTR_ARRAY
+};
+/* arguments of the interpreter: descriptors and byte order */
+#ifdef XPACKET_LITTLE_ENDIAN
+#define TABLE_ARGS CONSTANT(XPACKET_NAME, fields_), \
+  sizeof(CONSTANT(XPACKET_NAME, fields_)) / sizeof(struct xpacket_field), \
+  1, NATIVE_ORDER
+#else
+#define TABLE_ARGS CONSTANT(XPACKET_NAME, fields_), \
+  sizeof(CONSTANT(XPACKET_NAME, fields_)) / sizeof(struct xpacket_field), \
+  0, NATIVE_ORDER
+#endif
+#endif
+/* bit fields need the position in the current byte, and the other fields */
+/* begin at the next byte (as well as the end of the packet) */
+#ifdef XPACKET_BIT_FIELDS
+#define DECL_BIT uint8_t bit = 0; /* bit position in the current byte */
+#define ALIGN_BIT if (bit) { idx++; bit = 0; }
+#else
+#define DECL_BIT
+#define ALIGN_BIT
+#endif
+/* instrumentation hooks, named after the function and the packet */
+#define STRING(x) STRING_AUX(x)
+#define STRING_AUX(x) #x
+#ifdef XPACKET_TRACE_BEGIN
+#define TRACE_BEGIN(fn) XPACKET_TRACE_BEGIN(#fn "_" STRING(XPACKET_NAME));
+#else
+#define TRACE_BEGIN(fn)
+#endif
+#ifdef XPACKET_TRACE_END
+#define TRACE_END(fn, n) XPACKET_TRACE_END(#fn "_" STRING(XPACKET_NAME), n);
+#else
+#define TRACE_END(fn, n)
+#endif
+#define RETURN(fn, n) { TRACE_END(fn, n) return n; }
+/* FIELD_VAR serialization definition */
+#define FIELD_VAR(type, name) \
+  ALIGN_BIT \
+  CHANGED(memcmp(&_data->name, &_prev->name, sizeof(type))) { \
+    CHECK_BOUNDS(sizeof(type)) \
+    CODEC(put, type)(_pl + idx, _data->name); \
+    idx += sizeof(type); \
+  }
+/* FIELD_ARRAY is serialized as a whole (not element by element) */
+#define FIELD_ARRAY(type, name, dim) \
+  ALIGN_BIT \
+  CHANGED(memcmp(_data->name, _prev->name, sizeof(type) * (dim))) { \
+    CHECK_BOUNDS(sizeof(type) * (dim)) \
+    CODEC(put_array, type)(_pl + idx, _data->name, dim); \
+    idx += sizeof(type) * (dim); \
+  }
+/* FIELD_PTR_VAR serialization definition */
+#define FIELD_PTR_VAR(type, name) \
+  ALIGN_BIT \
+  CHANGED(memcmp(_data->name, _prev->name, sizeof(type))) { \
+    CHECK_BOUNDS(sizeof(type)) \
+    CODEC(put, type)(_pl + idx, *(_data->name)); \
+    idx += sizeof(type); \
+  }
+/* FIELD_PTR_ARRAY is serialized as a whole, like FIELD_ARRAY */
+/* (unless it is referenced by serialize_iov) */
+#define FIELD_PTR_ARRAY(type, name, dim) \
+  ALIGN_BIT \
+  CHANGED(memcmp(_data->name, _prev->name, sizeof(type) * (dim))) { \
+    CHECK_BOUNDS(sizeof(type) * (dim)) \
+    if (!REFERENCE(type, _data->name, dim)) { \
+      CODEC(put_array, type)(_pl + idx, _data->name, dim); \
+      idx += sizeof(type) * (dim); \
+    } \
+  }
+/* by default the arrays are not referenced */
+#define REFERENCE(type, ptr, dim) 0
+/* FIELD_VARRAY is serialized like FIELD_ARRAY, but only the used elements */
+#define FIELD_VARRAY(type, name, maxdim, lenfield) \
+  ALIGN_BIT \
+  CHANGED(_data->lenfield != _prev->lenfield || memcmp(_data->name, \
+      _prev->name, sizeof(type) * _data->lenfield)) { \
+    CHECK_LENGTH(_data->lenfield, maxdim) \
+    CHECK_BOUNDS(sizeof(type) * _data->lenfield) \
+    CODEC(put_array, type)(_pl + idx, _data->name, _data->lenfield); \
+    idx += sizeof(type) * _data->lenfield; \
+  }
+/* FIELD_VARINT serialization definition */
+#define FIELD_VARINT(type, name) \
+  ALIGN_BIT \
+  CHANGED(_data->name != _prev->name) { \
+    uint32_t _v = xpacket_varint_from_##type(_data->name); \
+    CHECK_BOUNDS(xpacket_size_varint(_v)) \
+    idx += xpacket_put_varint(_pl + idx, _v); \
+  }
+/* FIELD_BITS is packed after the previous bits (MSB first) */
+#define FIELD_BITS(type, name, nbits) \
+  CHANGED(_data->name != _prev->name) { \
+    CHECK_BOUNDS((bit + (nbits) + 7) / 8) \
+    xpacket_put_bits(_pl + idx, bit, nbits, _data->name, 1); \
+    idx += (bit + (nbits)) / 8; \
+    bit = (bit + (nbits)) % 8; \
+  }
+/* for FIELD_CUSTOM call the external function (that advances idx) */
+#define FIELD_CUSTOM(type, name, ser, de) \
+  ALIGN_BIT \
+  CHANGED(memcmp(&_data->name, &_prev->name, sizeof(type))) { \
+    ser(_pl + idx, &_data->name, &idx); \
+  }
+/* for FIELD_HOOK the function gets the available bytes, and returns the */
+/* ones written, or 0 if they are not enough (idx is not exposed to it) */
+#define FIELD_HOOK(type, name, ser, de) \
+  ALIGN_BIT \
+  CHANGED(memcmp(&_data->name, &_prev->name, sizeof(type))) { \
+    XPACKET_SIZE_TYPE _n = \
+      ser(_pl + idx, CHECK_LIMIT(XPACKET_SIZE_MAX - idx), &_data->name); \
+    CHECK_VALID(_n) \
+    idx += _n; \
+  }
+/* by default every field is serialized (see serialize_delta) */
+#define CHANGED(cond)
+/* the schema identifier, if required, precedes the fields */
+#ifdef XPACKET_SCHEMA_PREFIX
+#define FIELD_SCHEMA(fn) \
+  CHECK_BOUNDS(4) \
+  CODEC(put, uint32_t)(_pl + idx, CONSTANT(XPACKET_NAME, SCHEMA_ID)); \
+  idx += 4;
+#else
+#define FIELD_SCHEMA(fn)
+#endif
+/* the checksum, if required, follows the fields (computed over all the */
+/* bytes before it, in a single pass while they are still in the cache) */
+#ifdef XPACKET_CHECKSUM
+#define FIELD_CHECKSUM(fn) \
+  CHECK_BOUNDS(4) \
+  CODEC(put, uint32_t)(_pl + idx, xpacket_crc32c(0, _pl, idx)); \
+  idx += 4;
+#else
+#define FIELD_CHECKSUM(fn)
+#endif
 /**
  * \brief        Serialize the data in the given payload.
  * \param _pl    Payload memory address.
  * \param _data  Pointer to the structure that will be serialized.
  * \return       Number of bytes serialized.
  */
-uint16_t METHOD(serialize, XPACKET_NAME)
+LINKAGE XPACKET_SIZE_TYPE METHOD(serialize, XPACKET_NAME)
     (uint8_t* _pl, const struct XPACKET_NAME* _data) {
-  uint16_t idx = 0; /* index */
-  /* other variables declaration (if needed) */
-  #define FIELD_VAR(type, name)             DECL_OFFSET ||
-  #define FIELD_ARRAY(type, name, dim)      DECL_OFFSET || DECL_IT ||
-  #define FIELD_PTR_VAR(type, name)         DECL_OFFSET ||
-  #define FIELD_PTR_ARRAY(type, name, dim)  DECL_OFFSET || DECL_IT ||
-  #define FIELD_CUSTOM(type, name, ser, de)
-  /* offset variable */
-  #define DECL_OFFSET 1
-  #if (XPACKET_STRUCT 0)
-  int8_t offset = 0; /* offset for bit shifting */
+  XPACKET_SIZE_TYPE idx = 0; /* index */
+  DECL_BIT
+  TRACE_BEGIN(serialize)
+  /* substitution (without bounds checking) */
+  #define CHECK_BOUNDS(n)
+  #define CHECK_LENGTH(len, maxdim)
+  #define CHECK_LIMIT(n) (n)
+  #define CHECK_VALID(cond)
+  FIELD_SCHEMA(serialize)
+  #ifdef XPACKET_TABLE_LAYOUT
+  idx += xpacket_table_serialize(_pl + idx, _data, TABLE_ARGS);
+  #else
+  XPACKET_STRUCT
+  ALIGN_BIT
   #endif
-  #undef DECL_OFFSET
-  /* iterator variable */
-  #define DECL_IT 1
-  #if (XPACKET_STRUCT 0)
-  uint16_t it = 0; /* index for array iteration */
+  FIELD_CHECKSUM(serialize)
+  #undef CHECK_BOUNDS
+  #undef CHECK_LENGTH
+  #undef CHECK_LIMIT
+  #undef CHECK_VALID
+  /* return the number of bytes serialized */
+  RETURN(serialize, idx)
+}
+/**
+ * \brief        Serialize the data in the given payload, checking its size.
+ * \param _pl    Payload memory address.
+ * \param _len   Payload capacity (in bytes).
+ * \param _data  Pointer to the structure that will be serialized.
+ * \return       Number of bytes serialized, or 0 if capacity is not enough.
+ *
+ *    With a fixed layout the capacity is checked only once against the
+ *    wire size; otherwise it's checked before every field (FIELD_HOOK
+ *    functions get the available bytes). It fails also if the length of a
+ *    FIELD_VARRAY exceeds its maximum. It's not generated if the packet
+ *    has FIELD_CUSTOM fields, whose functions do not know the available
+ *    bytes (so they could write past them).
+ */
+#ifndef XPACKET_CUSTOM_FIELDS
+LINKAGE XPACKET_SIZE_TYPE METHOD(serialize_n, XPACKET_NAME)
+    (uint8_t* _pl, XPACKET_SIZE_TYPE _len, const struct XPACKET_NAME* _data) {
+  #ifdef XPACKET_FIXED_LAYOUT
+  if (_len < CONSTANT(XPACKET_NAME, WIRE_SIZE)) return 0;
+  return METHOD(serialize, XPACKET_NAME)(_pl, _data);
+  #else
+  XPACKET_SIZE_TYPE idx = 0; /* index */
+  DECL_BIT
+  TRACE_BEGIN(serialize_n)
+  /* substitution (with bounds checking) */
+  #define CHECK_BOUNDS(n) if (idx + (n) > _len) RETURN(serialize_n, 0)
+  #define CHECK_LENGTH(len, maxdim) \
+    if ((len) > (maxdim)) RETURN(serialize_n, 0)
+  #define CHECK_LIMIT(n) (_len - idx < (n) ? _len - idx : (n))
+  #define CHECK_VALID(cond) if (!(cond)) RETURN(serialize_n, 0)
+  FIELD_SCHEMA(serialize_n)
+  XPACKET_STRUCT
+  ALIGN_BIT
+  FIELD_CHECKSUM(serialize_n)
+  #undef CHECK_BOUNDS
+  #undef CHECK_LENGTH
+  #undef CHECK_LIMIT
+  #undef CHECK_VALID
+  /* return the number of bytes serialized */
+  RETURN(serialize_n, idx)
   #endif
-  #undef DECL_IT
-  /* undefine various macros */
-  #undef FIELD_VAR
-  #undef FIELD_ARRAY
-  #undef FIELD_PTR_VAR
-  #undef FIELD_PTR_ARRAY
-  #undef FIELD_CUSTOM
-  /* FIELD_VAR serialization definition */
-  #define FIELD_VAR(type, name) \
-    for (offset = (int8_t)sizeof(type) * 8 - 8; offset >= 0; offset -= 8) \
-      _pl[idx++] = _data->name >> offset;
-  /* "convert" FIELD_ARRAY in a FIELD_VAR macro, iterating over the array */
-  #define FIELD_ARRAY(type, name, dim) \
-    for (it = 0; it < dim; it++) { FIELD_VAR(type, name[it]) }
-  /* FIELD_PTR_VAR serialization definition */
-  #define FIELD_PTR_VAR(type, name) \
-    for (offset = (int8_t)sizeof(type) * 8 - 8; offset >= 0; offset -= 8) \
-      _pl[idx++] = *(_data->name) >> offset;
-  /* FIELD_PTR_ARRAY into FIELD_PTR_VAR macro, iterating over the array */
-  #define FIELD_PTR_ARRAY(type, name, dim) \
-    for (it = 0; it < dim; it++) { FIELD_PTR_VAR(type, name + it) }
-  /* for FIELD_CUSTOM call the external function */
-  #define FIELD_CUSTOM(type, name, ser, de) ser(_pl + idx, &_data->name, &idx);
-  /* substitution */
+}
+#endif
+#ifdef XPACKET_FIXED_LAYOUT
+/**
+ * \brief        Serialize an array of structures in the given payload.
+ * \param _out   Payload memory address.
+ * \param _in    Array of structures that will be serialized.
+ * \param _n     Number of structures.
+ * \return       Number of bytes serialized.
+ *
+ *    The i-th structure is serialized at offset i * WIRE_SIZE; records are
+ *    independent, so the loop can be vectorized by the compiler, and
+ *    disjoint chunks can be serialized in parallel by different threads.
+ */
+LINKAGE size_t METHOD(serialize_batch, XPACKET_NAME)
+    (uint8_t* _out, const struct XPACKET_NAME* _in, size_t _n) {
+  size_t i;
+  TRACE_BEGIN(serialize_batch)
+  for (i = 0; i < _n; i++) {
+    uint8_t* _pl = _out + i * CONSTANT(XPACKET_NAME, WIRE_SIZE);
+    const struct XPACKET_NAME* _data = _in + i;
+    XPACKET_SIZE_TYPE idx = 0; /* index */
+    DECL_BIT
+    /* substitution (without bounds checking) */
+    #define CHECK_BOUNDS(n)
+    FIELD_SCHEMA(serialize_batch)
+    #ifdef XPACKET_TABLE_LAYOUT
+    idx += xpacket_table_serialize(_pl + idx, _data, TABLE_ARGS);
+    #else
+    XPACKET_STRUCT
+    ALIGN_BIT
+    #endif
+    FIELD_CHECKSUM(serialize_batch)
+    #undef CHECK_BOUNDS
+  }
+  /* return the number of bytes serialized */
+  RETURN(serialize_batch, _n * CONSTANT(XPACKET_NAME, WIRE_SIZE))
+}
+#endif
+#ifdef XPACKET_IOV
+/**
+ * \brief        Serialize the data in iovec entries, without copying arrays.
+ * \param _pl    Payload memory address (for the fields not referenced).
+ * \param _iov   Array of (at least) IOV_ENTRIES iovec entries.
+ * \param _data  Pointer to the structure that will be serialized.
+ * \return       Number of iovec entries used.
+ *
+ *    The FIELD_PTR_ARRAY data that do not need any conversion (uint8_t
+ *    types, or the host byte order) are directly referenced by the iovec
+ *    entries, while the other fields are serialized in the payload as
+ *    usual; so the entries, in order, hold the whole serialized packet,
+ *    ready for writev or sendmsg (the referenced data must not change
+ *    before).
+ */
+LINKAGE uint16_t METHOD(serialize_iov, XPACKET_NAME)
+    (uint8_t* _pl, struct iovec* _iov, const struct XPACKET_NAME* _data) {
+  XPACKET_SIZE_TYPE idx = 0; /* index */
+  XPACKET_SIZE_TYPE seg = 0; /* index of the pending segment */
+  uint16_t niov = 0; /* number of iovec entries */
+  DECL_BIT
+  TRACE_BEGIN(serialize_iov)
+  /* substitution (without bounds checking, but referencing the arrays) */
+  #define CHECK_BOUNDS(n)
+  #define CHECK_LENGTH(len, maxdim)
+  #define CHECK_LIMIT(n) (n)
+  #define CHECK_VALID(cond)
+  #undef REFERENCE
+  #define REFERENCE(type, ptr, dim) ((sizeof(type) == 1 || NATIVE_ORDER) && \
+    (niov = xpacket_iov_add(_iov, niov, _pl + seg, idx - seg, \
+      ptr, sizeof(type) * (dim)), seg = idx, 1))
+  FIELD_SCHEMA(serialize_iov)
   XPACKET_STRUCT
-  /* undefine temporary macros */
-  #undef FIELD_VAR
-  #undef FIELD_ARRAY
-  #undef FIELD_PTR_VAR
-  #undef FIELD_PTR_ARRAY
-  #undef FIELD_CUSTOM
+  ALIGN_BIT
+  #undef CHECK_BOUNDS
+  #undef CHECK_LENGTH
+  #undef CHECK_LIMIT
+  #undef CHECK_VALID
+  #undef REFERENCE
+  #define REFERENCE(type, ptr, dim) 0
+  #ifdef XPACKET_CHECKSUM
+  /* the checksum covers the referenced arrays too (in the pending segment) */
+  {
+    uint32_t _crc = 0;
+    uint16_t _k;
+    for (_k = 0; _k < niov; _k++)
+      _crc = xpacket_crc32c(_crc, (const uint8_t*)_iov[_k].iov_base,
+        _iov[_k].iov_len);
+    _crc = xpacket_crc32c(_crc, _pl + seg, idx - seg);
+    CODEC(put, uint32_t)(_pl + idx, _crc);
+    idx += 4;
+  }
+  #endif
+  /* the last pending segment */
+  if (idx > seg) {
+    _iov[niov].iov_base = _pl + seg;
+    _iov[niov].iov_len = idx - seg;
+    niov++;
+  }
+  TRACE_END(serialize_iov, xpacket_iov_size(_iov, niov))
+  return niov;
+}
+#endif
+#ifdef XPACKET_DELTA
+/**
+ * \brief        Serialize only the fields changed from a previous structure.
+ * \param _pl    Payload memory address.
+ * \param _data  Pointer to the structure that will be serialized.
+ * \param _prev  Pointer to the previous structure (already sent).
+ * \return       Number of bytes serialized.
+ *
+ *    The payload begins with the presence bitmap (DELTA_MAP bytes, a bit
+ *    for every field in order, MSB first), after the schema identifier if
+ *    XPACKET_SCHEMA_PREFIX is defined, followed by the fields whose bitmap
+ *    bit is set, serialized as usual; the fields are compared by value
+ *    (the targets of FIELD_PTR, the used elements of FIELD_VARRAY).
+ */
+LINKAGE XPACKET_SIZE_TYPE METHOD(serialize_delta, XPACKET_NAME)
+    (uint8_t* _pl, const struct XPACKET_NAME* _data,
+    const struct XPACKET_NAME* _prev) {
+  XPACKET_SIZE_TYPE idx = 0; /* index */
+  uint8_t* _map = _pl + SCHEMA_SIZE; /* presence bitmap */
+  uint16_t _f = 0; /* index of the field in the bitmap */
+  DECL_BIT
+  TRACE_BEGIN(serialize_delta)
+  /* substitution (without bounds checking, only the changed fields) */
+  #define CHECK_BOUNDS(n)
+  #define CHECK_LENGTH(len, maxdim)
+  #define CHECK_LIMIT(n) (n)
+  #define CHECK_VALID(cond)
+  #undef CHANGED
+  #define CHANGED(cond) if (xpacket_delta_mark(_map, _f++, cond))
+  FIELD_SCHEMA(serialize_delta)
+  memset(_map, 0, CONSTANT(XPACKET_NAME, DELTA_MAP));
+  idx += CONSTANT(XPACKET_NAME, DELTA_MAP);
+  XPACKET_STRUCT
+  ALIGN_BIT
+  FIELD_CHECKSUM(serialize_delta)
+  #undef CHECK_BOUNDS
+  #undef CHECK_LENGTH
+  #undef CHECK_LIMIT
+  #undef CHECK_VALID
+  #undef CHANGED
+  #define CHANGED(cond)
   /* return the number of bytes serialized */
-  return idx;
+  RETURN(serialize_delta, idx)
 }
+#endif
+/* undefine temporary macros */
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+#undef FIELD_SCHEMA
+#undef FIELD_CHECKSUM
+#undef REFERENCE
+#undef CHANGED
 /*---------------------------------------------------------------------------*/
+/* FIELD_VAR deserialization definition */
+#define FIELD_VAR(type, name) \
+  ALIGN_BIT \
+  PRESENT { \
+    CHECK_BOUNDS(sizeof(type)) \
+    _data->name = CODEC(get, type)(_pl + idx); \
+    idx += sizeof(type); \
+  }
+/* FIELD_ARRAY is deserialized as a whole (not element by element) */
+#define FIELD_ARRAY(type, name, dim) \
+  ALIGN_BIT \
+  PRESENT { \
+    CHECK_BOUNDS(sizeof(type) * (dim)) \
+    CODEC(get_array, type)(_pl + idx, _data->name, dim); \
+    idx += sizeof(type) * (dim); \
+  }
+/* FIELD_PTR_VAR deserialization definition */
+/* (deserialize_arena allocates the target, or points it in the payload) */
+#define FIELD_PTR_VAR(type, name) \
+  ALIGN_BIT \
+  PRESENT { \
+    CHECK_BOUNDS(sizeof(type)) \
+    ALLOCATE(type, _data->name, 1) \
+    if (!ALIASED(_data->name)) \
+      *(_data->name) = CODEC(get, type)(_pl + idx); \
+    idx += sizeof(type); \
+  }
+/* FIELD_PTR_ARRAY is deserialized as a whole, like FIELD_ARRAY */
+#define FIELD_PTR_ARRAY(type, name, dim) \
+  ALIGN_BIT \
+  PRESENT { \
+    CHECK_BOUNDS(sizeof(type) * (dim)) \
+    ALLOCATE(type, _data->name, dim) \
+    if (!ALIASED(_data->name)) \
+      CODEC(get_array, type)(_pl + idx, _data->name, dim); \
+    idx += sizeof(type) * (dim); \
+  }
+/* by default the targets are given by the caller */
+#define ALLOCATE(type, ptr, dim)
+#define ALIASED(ptr) 0
+/* FIELD_VARRAY is deserialized like FIELD_ARRAY, for the used elements */
+#define FIELD_VARRAY(type, name, maxdim, lenfield) \
+  ALIGN_BIT \
+  PRESENT { \
+    CHECK_LENGTH(_data->lenfield, maxdim) \
+    CHECK_BOUNDS(sizeof(type) * _data->lenfield) \
+    CODEC(get_array, type)(_pl + idx, _data->name, _data->lenfield); \
+    idx += sizeof(type) * _data->lenfield; \
+  }
+/* FIELD_VARINT deserialization definition (at most 5 bytes are read, and */
+/* the checked functions fail if they do not fit the type) */
+#define FIELD_VARINT(type, name) \
+  ALIGN_BIT \
+  PRESENT { \
+    uint32_t _v; \
+    uint8_t _n = xpacket_get_varint(_pl + idx, CHECK_LIMIT(5), &_v); \
+    CHECK_VALID(xpacket_check_varint(_pl + idx, _n, _v, 8 * sizeof(type))) \
+    _data->name = xpacket_varint_to_##type(_v); \
+    idx += _n; \
+  }
+/* FIELD_BITS deserialization definition */
+#define FIELD_BITS(type, name, nbits) \
+  PRESENT { \
+    CHECK_BOUNDS((bit + (nbits) + 7) / 8) \
+    _data->name = (type)xpacket_get_bits(_pl + idx, bit, nbits); \
+    idx += (bit + (nbits)) / 8; \
+    bit = (bit + (nbits)) % 8; \
+  }
+/* for FIELD_CUSTOM call the external function (that advances idx) */
+#define FIELD_CUSTOM(type, name, ser, de) \
+  ALIGN_BIT \
+  PRESENT { \
+    de(_pl + idx, &_data->name, &idx); \
+  }
+/* for FIELD_HOOK the function returns the bytes read (0 if invalid) */
+#define FIELD_HOOK(type, name, ser, de) \
+  ALIGN_BIT \
+  PRESENT { \
+    XPACKET_SIZE_TYPE _n = \
+      de(_pl + idx, CHECK_LIMIT(XPACKET_SIZE_MAX - idx), &_data->name); \
+    CHECK_VALID(_n) \
+    idx += _n; \
+  }
+/* by default every field is deserialized (see deserialize_delta) */
+#define PRESENT
+/* a different schema identifier fails (even without bounds checking) */
+#ifdef XPACKET_SCHEMA_PREFIX
+#define FIELD_SCHEMA(fn) \
+  CHECK_BOUNDS(4) \
+  if (CODEC(get, uint32_t)(_pl + idx) != \
+      (uint32_t)CONSTANT(XPACKET_NAME, SCHEMA_ID)) RETURN(fn, 0) \
+  idx += 4;
+#else
+#define FIELD_SCHEMA(fn)
+#endif
+/* a wrong checksum fails too (even without bounds checking) */
+#ifdef XPACKET_CHECKSUM
+#define FIELD_CHECKSUM(fn) \
+  CHECK_BOUNDS(4) \
+  if (CODEC(get, uint32_t)(_pl + idx) != xpacket_crc32c(0, _pl, idx)) \
+    RETURN(fn, 0) \
+  idx += 4;
+#else
+#define FIELD_CHECKSUM(fn)
+#endif
 /**
  * \brief        Deserialize the payload in the structure.
  * \param _pl    Payload memory address.
  * \param _data  Pointer to the structure where values will be saved.
  * \return       Number of bytes deserialized.
  */
-uint16_t METHOD(deserialize, XPACKET_NAME)
+LINKAGE XPACKET_SIZE_TYPE METHOD(deserialize, XPACKET_NAME)
     (const uint8_t* _pl, struct XPACKET_NAME* _data) {
-  uint16_t idx = 0; /* index */
-  /* other variables declaration (if needed) */
-  #define FIELD_VAR(type, name)             DECL_OFFSET ||
-  #define FIELD_ARRAY(type, name, dim)      DECL_OFFSET || DECL_IT ||
-  #define FIELD_PTR_VAR(type, name)         DECL_OFFSET ||
-  #define FIELD_PTR_ARRAY(type, name, dim)  DECL_OFFSET || DECL_IT ||
-  #define FIELD_CUSTOM(type, name, ser, de)
-  /* offset variable */
-  #define DECL_OFFSET 1
-  #if (XPACKET_STRUCT 0)
-  int8_t offset = 0; /* offset for bit shifting */
+  XPACKET_SIZE_TYPE idx = 0; /* index */
+  DECL_BIT
+  TRACE_BEGIN(deserialize)
+  /* substitution (without bounds checking, but never overflowing arrays) */
+  #define CHECK_BOUNDS(n)
+  #define CHECK_LENGTH(len, maxdim) if ((len) > (maxdim)) (len) = (maxdim);
+  #define CHECK_LIMIT(n) (n)
+  #define CHECK_VALID(cond)
+  FIELD_SCHEMA(deserialize)
+  #ifdef XPACKET_TABLE_LAYOUT
+  idx += xpacket_table_deserialize(_pl + idx, _data, TABLE_ARGS);
+  #else
+  XPACKET_STRUCT
+  ALIGN_BIT
   #endif
-  #undef DECL_OFFSET
-  /* iterator variable */
-  #define DECL_IT 1
-  #if (XPACKET_STRUCT 0)
-  uint16_t it = 0; /* index for array iteration */
+  FIELD_CHECKSUM(deserialize)
+  #undef CHECK_BOUNDS
+  #undef CHECK_LENGTH
+  #undef CHECK_LIMIT
+  #undef CHECK_VALID
+  /* return the number of bytes deserialized */
+  RETURN(deserialize, idx)
+}
+/**
+ * \brief        Deserialize the payload in the structure, checking its size.
+ * \param _pl    Payload memory address.
+ * \param _len   Payload length (in bytes).
+ * \param _data  Pointer to the structure where values will be saved.
+ * \return       Number of bytes deserialized, or 0 if payload is truncated.
+ *
+ *    The length is checked like in the serialize_n function (and it's not
+ *    generated with FIELD_CUSTOM fields either); it fails also if a
+ *    FIELD_VARINT does not fit its type (a larger value, or more bytes than
+ *    the ones needed by its bits). When it fails, the structure may be
+ *    partially overwritten.
+ */
+#ifndef XPACKET_CUSTOM_FIELDS
+LINKAGE XPACKET_SIZE_TYPE METHOD(deserialize_n, XPACKET_NAME)
+    (const uint8_t* _pl, XPACKET_SIZE_TYPE _len, struct XPACKET_NAME* _data) {
+  #ifdef XPACKET_FIXED_LAYOUT
+  if (_len < CONSTANT(XPACKET_NAME, WIRE_SIZE)) return 0;
+  return METHOD(deserialize, XPACKET_NAME)(_pl, _data);
+  #else
+  XPACKET_SIZE_TYPE idx = 0; /* index */
+  DECL_BIT
+  TRACE_BEGIN(deserialize_n)
+  /* substitution (with bounds checking) */
+  #define CHECK_BOUNDS(n) if (idx + (n) > _len) RETURN(deserialize_n, 0)
+  #define CHECK_LENGTH(len, maxdim) \
+    if ((len) > (maxdim)) RETURN(deserialize_n, 0)
+  #define CHECK_LIMIT(n) (_len - idx < (n) ? _len - idx : (n))
+  #define CHECK_VALID(cond) if (!(cond)) RETURN(deserialize_n, 0)
+  FIELD_SCHEMA(deserialize_n)
+  XPACKET_STRUCT
+  ALIGN_BIT
+  FIELD_CHECKSUM(deserialize_n)
+  #undef CHECK_BOUNDS
+  #undef CHECK_LENGTH
+  #undef CHECK_LIMIT
+  #undef CHECK_VALID
+  /* return the number of bytes deserialized */
+  RETURN(deserialize_n, idx)
   #endif
-  #undef DECL_IT
-  /* undefine various macros */
-  #undef FIELD_VAR
-  #undef FIELD_ARRAY
-  #undef FIELD_PTR_VAR
-  #undef FIELD_PTR_ARRAY
-  #undef FIELD_CUSTOM
-  /* FIELD_VAR deserialization definition */
-  #define FIELD_VAR(type, name) \
-    _data->name = 0; /* set value to zero for next bitwise OR operations */ \
-    for (offset = (int8_t)sizeof(type) * 8 - 8; offset >= 0; offset -= 8) \
-      _data->name |= (type)_pl[idx++] << offset;
-  /* "convert" FIELD_ARRAY in a FIELD_VAR macro, iterating over the array */
-  #define FIELD_ARRAY(type, name, dim) \
-    for (it = 0; it < dim; it++) { FIELD_VAR(type, name[it]) }
-  /* FIELD_PTR_VAR deserialization definition */
-  #define FIELD_PTR_VAR(type, name) \
-    *(_data->name) = 0; /* set value to zero for next bitwise OR operations */ \
-    for (offset = (int8_t)sizeof(type) * 8 - 8; offset >= 0; offset -= 8) \
-      *(_data->name) |= (type)_pl[idx++] << offset;
-  /* "convert" FIELD_ARRAY in a FIELD_VAR macro, iterating over the array */
-  #define FIELD_PTR_ARRAY(type, name, dim) \
-    for (it = 0; it < dim; it++) { FIELD_PTR_VAR(type, name + it) }
-  /* for FIELD_CUSTOM call the external function */
-  #define FIELD_CUSTOM(type, name, ser, de) de(_pl + idx, &_data->name, &idx);
-  /* substitution */
+}
+#endif
+#if defined(XPACKET_ARENA) && !defined(XPACKET_CUSTOM_FIELDS)
+/**
+ * \brief        Deserialize the payload, allocating the pointer targets.
+ * \param _pl    Payload memory address.
+ * \param _len   Payload length (in bytes).
+ * \param _data  Pointer to the structure where values will be saved.
+ * \param _arena Arena where the targets of the FIELD_PTR fields are
+ *               allocated (in order).
+ * \return       Number of bytes deserialized, or 0 if payload is truncated
+ *               (or the arena is exhausted).
+ *
+ *    The length is checked like in the deserialize_n function. If
+ *    XPACKET_ARENA_ALIAS is defined, the targets that do not need any
+ *    conversion (uint8_t types, or the host byte order, and suitably
+ *    aligned) point directly in the payload instead, so they must be only
+ *    read, and only while the payload is valid.
+ */
+LINKAGE XPACKET_SIZE_TYPE METHOD(deserialize_arena, XPACKET_NAME)
+    (const uint8_t* _pl, XPACKET_SIZE_TYPE _len, struct XPACKET_NAME* _data,
+    struct xpacket_arena* _arena) {
+  XPACKET_SIZE_TYPE idx = 0; /* index */
+  DECL_BIT
+  (void)_arena; /* unused if there are no FIELD_PTR fields */
+  TRACE_BEGIN(deserialize_arena)
+  /* substitution (with bounds checking and allocation) */
+  #define CHECK_BOUNDS(n) if (idx + (n) > _len) RETURN(deserialize_arena, 0)
+  #define CHECK_LENGTH(len, maxdim) \
+    if ((len) > (maxdim)) RETURN(deserialize_arena, 0)
+  #define CHECK_LIMIT(n) (_len - idx < (n) ? _len - idx : (n))
+  #define CHECK_VALID(cond) if (!(cond)) RETURN(deserialize_arena, 0)
+  #undef ALLOCATE
+  #undef ALIASED
+  /* targets pointed in the payload (only with XPACKET_ARENA_ALIAS) */
+  #ifdef XPACKET_ARENA_ALIAS
+  #define ALIAS(type) ((sizeof(type) == 1 || NATIVE_ORDER) && \
+    (uintptr_t)(_pl + idx) % sizeof(type) == 0)
+  #define ALIASED(ptr) ((const void*)(ptr) == (const void*)(_pl + idx))
+  #else
+  #define ALIAS(type) 0
+  #define ALIASED(ptr) 0
+  #endif
+  #define ALLOCATE(type, ptr, dim) \
+    if (ALIAS(type)) ptr = (type*)(uintptr_t)(_pl + idx); \
+    else if (!(ptr = (type*)xpacket_arena_alloc \
+        (_arena, sizeof(type) * (dim), sizeof(type)))) \
+      RETURN(deserialize_arena, 0)
+  FIELD_SCHEMA(deserialize_arena)
+  XPACKET_STRUCT
+  ALIGN_BIT
+  FIELD_CHECKSUM(deserialize_arena)
+  #undef CHECK_BOUNDS
+  #undef CHECK_LENGTH
+  #undef CHECK_LIMIT
+  #undef CHECK_VALID
+  #undef ALIAS
+  #undef ALLOCATE
+  #undef ALIASED
+  #define ALLOCATE(type, ptr, dim)
+  #define ALIASED(ptr) 0
+  /* return the number of bytes deserialized */
+  RETURN(deserialize_arena, idx)
+}
+#endif
+#ifdef XPACKET_FIXED_LAYOUT
+/**
+ * \brief        Deserialize the payload in an array of structures.
+ * \param _in    Payload memory address.
+ * \param _out   Array of structures where values will be saved.
+ * \param _n     Number of structures.
+ * \return       Number of bytes deserialized.
+ *
+ *    The dual of the serialize_batch function.
+ */
+LINKAGE size_t METHOD(deserialize_batch, XPACKET_NAME)
+    (const uint8_t* _in, struct XPACKET_NAME* _out, size_t _n) {
+  size_t i;
+  TRACE_BEGIN(deserialize_batch)
+  for (i = 0; i < _n; i++) {
+    const uint8_t* _pl = _in + i * CONSTANT(XPACKET_NAME, WIRE_SIZE);
+    struct XPACKET_NAME* _data = _out + i;
+    XPACKET_SIZE_TYPE idx = 0; /* index */
+    DECL_BIT
+    /* substitution (without bounds checking) */
+    #define CHECK_BOUNDS(n)
+    FIELD_SCHEMA(deserialize_batch)
+    #ifdef XPACKET_TABLE_LAYOUT
+    idx += xpacket_table_deserialize(_pl + idx, _data, TABLE_ARGS);
+    #else
+    XPACKET_STRUCT
+    ALIGN_BIT
+    #endif
+    FIELD_CHECKSUM(deserialize_batch)
+    #undef CHECK_BOUNDS
+  }
+  /* return the number of bytes deserialized */
+  RETURN(deserialize_batch, _n * CONSTANT(XPACKET_NAME, WIRE_SIZE))
+}
+#endif
+#ifdef XPACKET_DELTA
+/**
+ * \brief        Patch the structure with the fields of a delta payload.
+ * \param _pl    Payload memory address (from serialize_delta).
+ * \param _data  Pointer to the previous structure, updated in place.
+ * \return       Number of bytes deserialized.
+ *
+ *    Only the fields present in the bitmap are overwritten, so _data must
+ *    hold the same structure given as previous one to serialize_delta; a
+ *    different schema identifier fails, like in deserialize.
+ */
+LINKAGE XPACKET_SIZE_TYPE METHOD(deserialize_delta, XPACKET_NAME)
+    (const uint8_t* _pl, struct XPACKET_NAME* _data) {
+  XPACKET_SIZE_TYPE idx = 0; /* index */
+  const uint8_t* _map = _pl + SCHEMA_SIZE; /* presence bitmap */
+  uint16_t _f = 0; /* index of the field in the bitmap */
+  DECL_BIT
+  TRACE_BEGIN(deserialize_delta)
+  /* substitution (without bounds checking, only the present fields) */
+  #define CHECK_BOUNDS(n)
+  #define CHECK_LENGTH(len, maxdim) if ((len) > (maxdim)) (len) = (maxdim);
+  #define CHECK_LIMIT(n) (n)
+  #define CHECK_VALID(cond)
+  #undef PRESENT
+  #define PRESENT if (xpacket_delta_test(_map, _f++))
+  FIELD_SCHEMA(deserialize_delta)
+  idx += CONSTANT(XPACKET_NAME, DELTA_MAP);
+  XPACKET_STRUCT
+  ALIGN_BIT
+  FIELD_CHECKSUM(deserialize_delta)
+  #undef CHECK_BOUNDS
+  #undef CHECK_LENGTH
+  #undef CHECK_LIMIT
+  #undef CHECK_VALID
+  #undef PRESENT
+  #define PRESENT
+  /* return the number of bytes deserialized */
+  RETURN(deserialize_delta, idx)
+}
+#endif
+/* undefine temporary macros */
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_VARRAY
+#undef FIELD_VARINT
+#undef FIELD_BITS
+#undef FIELD_CUSTOM
+#undef FIELD_HOOK
+#undef FIELD_SCHEMA
+#undef FIELD_CHECKSUM
+#undef ALLOCATE
+#undef ALIASED
+#undef PRESENT
+/*---------------------------------------------------------------------------*/
+#ifdef XPACKET_COLUMN_LAYOUT
+/* columnar serialization: a loop on the records for every field */
+#define FIELD_VAR(type, name) \
+  for (i = 0; i < _n; i++) \
+    CODEC(put, type)(_out + COLUMN(name) + sizeof(type) * i, _in[i].name);
+#define FIELD_ARRAY(type, name, dim) \
+  for (i = 0; i < _n; i++) \
+    CODEC(put_array, type)(_out + COLUMN(name) + sizeof(type) * (dim) * i, \
+      _in[i].name, dim);
+#define FIELD_PTR_VAR(type, name) \
+  for (i = 0; i < _n; i++) \
+    CODEC(put, type)(_out + COLUMN(name) + sizeof(type) * i, *(_in[i].name));
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+/**
+ * \brief        Serialize an array of structures, a field after the other.
+ * \param _out   Payload memory address.
+ * \param _in    Array of structures that will be serialized.
+ * \param _n     Number of structures.
+ * \return       Number of bytes serialized.
+ *
+ *    The payload holds a column for every field (the values of all the
+ *    structures, serialized as usual), in order and without the schema
+ *    prefix and the checksum; so scanning a field reads only its column
+ *    (see the column readers), and the columns are contiguous runs of the
+ *    same type.
+ */
+LINKAGE size_t METHOD(serialize_columns, XPACKET_NAME)
+    (uint8_t* _out, const struct XPACKET_NAME* _in, size_t _n) {
+  size_t i;
+  TRACE_BEGIN(serialize_columns)
   XPACKET_STRUCT
-  /* undefine temporary macros */
-  #undef FIELD_VAR
-  #undef FIELD_ARRAY
-  #undef FIELD_PTR_VAR
-  #undef FIELD_PTR_ARRAY
-  #undef FIELD_CUSTOM
   /* return the number of bytes serialized */
-  return idx;
+  RETURN(serialize_columns,
+    _n * (CONSTANT(XPACKET_NAME, WIRE_SIZE) - SCHEMA_SIZE - CHECKSUM_SIZE))
+}
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+/* columnar deserialization */
+#define FIELD_VAR(type, name) \
+  for (i = 0; i < _n; i++) \
+    _out[i].name = CODEC(get, type)(_in + COLUMN(name) + sizeof(type) * i);
+#define FIELD_ARRAY(type, name, dim) \
+  for (i = 0; i < _n; i++) \
+    CODEC(get_array, type)(_in + COLUMN(name) + sizeof(type) * (dim) * i, \
+      _out[i].name, dim);
+#define FIELD_PTR_VAR(type, name) \
+  for (i = 0; i < _n; i++) \
+    *(_out[i].name) = \
+      CODEC(get, type)(_in + COLUMN(name) + sizeof(type) * i);
+#define FIELD_PTR_ARRAY(type, name, dim)  FIELD_ARRAY(type, name, dim)
+/**
+ * \brief        Deserialize a columnar payload in an array of structures.
+ * \param _in    Payload memory address.
+ * \param _out   Array of structures where values will be saved.
+ * \param _n     Number of structures.
+ * \return       Number of bytes deserialized.
+ *
+ *    The dual of the serialize_columns function.
+ */
+LINKAGE size_t METHOD(deserialize_columns, XPACKET_NAME)
+    (const uint8_t* _in, struct XPACKET_NAME* _out, size_t _n) {
+  size_t i;
+  TRACE_BEGIN(deserialize_columns)
+  XPACKET_STRUCT
+  /* return the number of bytes deserialized */
+  RETURN(deserialize_columns,
+    _n * (CONSTANT(XPACKET_NAME, WIRE_SIZE) - SCHEMA_SIZE - CHECKSUM_SIZE))
+}
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#endif
+/*---------------------------------------------------------------------------*/
+#ifdef XPACKET_FIXED_LAYOUT
+/* streaming deserialization: every field is a STEP, with its first and */
+/* last byte, and the statement that deserializes it from SOURCE */
+#define FIELD_VAR(type, name) \
+  STEP(name, _data->name = CODEC(get, type)(SOURCE(name));)
+#define FIELD_ARRAY(type, name, dim) \
+  STEP(name, CODEC(get_array, type)(SOURCE(name), _data->name, dim);)
+#define FIELD_PTR_VAR(type, name) \
+  STEP(name, *(_data->name) = CODEC(get, type)(SOURCE(name));)
+#define FIELD_PTR_ARRAY(type, name, dim) \
+  STEP(name, CODEC(get_array, type)(SOURCE(name), _data->name, dim);)
+#define FIELD_BITS(type, name, nbits) \
+  STEP(name, _data->name = (type)xpacket_get_bits(SOURCE(name), \
+    CONSTANT(XPACKET_NAME, BIT_##name) % 8, nbits);)
+#define FIRST(name) CONSTANT(XPACKET_NAME, OFF_##name)
+#define LAST(name) (CONSTANT(XPACKET_NAME, name##_LAST_) / 8)
+/* the fields that began in the previous calls are read from the buffer */
+#define SOURCE(name) \
+  (FIRST(name) < old ? _dec->buf + FIRST(name) : _in + (FIRST(name) - old))
+/**
+ * \brief        Deserialize a fragment of the payload in the structure.
+ * \param _dec   Decoder state (zero-initialized before the first call).
+ * \param _data  Pointer to the structure where values will be saved.
+ * \param _in    Fragment of the payload.
+ * \param _len   Length of the fragment (in bytes).
+ * \return       Number of bytes used (only the ones of the current packet).
+ *
+ *    Every field is deserialized as soon as its last byte is fed, directly
+ *    from the fragment if it is entirely in it; only the bytes of the
+ *    fields split between fragments are copied in the decoder buffer.
+ *    The packet is complete when _dec->pos is equal to WIRE_SIZE, and the
+ *    following call begins a new one (so a stream of packets can be fed
+ *    calling the function, until all the bytes are used).
+ */
+LINKAGE size_t METHOD(feed, XPACKET_NAME)
+    (struct CONSTANT(XPACKET_NAME, decoder)* _dec,
+    struct XPACKET_NAME* _data, const uint8_t* _in, size_t _len) {
+  XPACKET_SIZE_TYPE old, end;
+  #ifndef XPACKET_TABLE_LAYOUT
+  XPACKET_SIZE_TYPE fill, pend;
+  size_t _s;
+  /* first and last byte of every field (a loop is cheaper to compile) */
+  static const XPACKET_SIZE_TYPE _steps[][2] = {
+    #define STEP(name, ...) { FIRST(name), LAST(name) },
+    XPACKET_STRUCT
+    #undef STEP
+  };
+  #endif
+  TRACE_BEGIN(feed)
+  if (_dec->pos == CONSTANT(XPACKET_NAME, WIRE_SIZE)) _dec->pos = 0;
+  old = _dec->pos; /* first byte of the fragment */
+  end = _len < (size_t)(CONSTANT(XPACKET_NAME, WIRE_SIZE) - old) ?
+    (XPACKET_SIZE_TYPE)(old + _len) :
+    (XPACKET_SIZE_TYPE)CONSTANT(XPACKET_NAME, WIRE_SIZE);
+  #ifdef XPACKET_TABLE_LAYOUT
+  /* the whole packet is buffered, and deserialized when it's complete */
+  memcpy(_dec->buf + old, _in, end - old);
+  if (end == CONSTANT(XPACKET_NAME, WIRE_SIZE))
+    METHOD(deserialize, XPACKET_NAME)(_dec->buf, _data);
+  #else
+  /* complete the buffered fields */
+  fill = old;
+  for (_s = 0; _s < sizeof(_steps) / sizeof(_steps[0]); _s++)
+    if (_steps[_s][0] < old && old <= _steps[_s][1] && _steps[_s][1] >= fill)
+      fill = _steps[_s][1] + 1;
+  if (fill > end) fill = end;
+  memcpy(_dec->buf + old, _in, fill - old);
+  /* deserialize the fields whose last byte is in the fragment */
+  #define STEP(name, ...) \
+    if (LAST(name) >= old && LAST(name) < end) { __VA_ARGS__ }
+  XPACKET_STRUCT
+  #undef STEP
+  /* buffer the fields that are not complete */
+  pend = end;
+  for (_s = 0; _s < sizeof(_steps) / sizeof(_steps[0]); _s++)
+    if (_steps[_s][0] < pend && end <= _steps[_s][1]) pend = _steps[_s][0];
+  if (pend < old) pend = old;
+  memcpy(_dec->buf + pend, _in + (pend - old), end - pend);
+  #endif
+  _dec->pos = end;
+  TRACE_END(feed, end - old)
+  return end - old;
 }
+#undef FIELD_VAR
+#undef FIELD_ARRAY
+#undef FIELD_PTR_VAR
+#undef FIELD_PTR_ARRAY
+#undef FIELD_BITS
+#undef FIRST
+#undef LAST
+#undef SOURCE
+#endif
 /*---------------------------------------------------------------------------*/
 /* end of file */
+#undef DECL_BIT
+#undef ALIGN_BIT
+#undef TABLE_ARGS
+#undef STRING
+#undef STRING_AUX
+#undef TRACE_BEGIN
+#undef TRACE_END
+#undef RETURN
 #endif /* XPACKET_C */
+/* extension header (e.g. xpacket.hpp), that can use the macros above */
+#ifdef XPACKET_EXTENSION
+#include XPACKET_EXTENSION
+#endif
 #undef METHOD
 #undef METHOD_AUX
+#undef LINKAGE
+#undef CONSTANT
+#undef CONSTANT_AUX
+#undef CODEC
+#undef CODEC_AUX
+#undef NATIVE_ORDER
+#undef ACCESSOR
+#undef FIXED_PREFIX
+#undef FIXED_PREFIX_END
+#undef FIXED_PREFIX_EAT
+#undef SCHEMA_SIZE
+#undef CHECKSUM_SIZE
+#undef COLUMN
+#undef XPACKET_FIXED_LAYOUT
+#undef XPACKET_BIT_FIELDS
+#undef XPACKET_CUSTOM_FIELDS
+#undef XPACKET_TABLE_LAYOUT
+#undef XPACKET_COLUMN_LAYOUT
 #endif /* XPACKET_BAD_FORMAT (struct format check) */
+/* undefine the type codes (used also by the schema fingerprint) */
+#undef XPACKET_TYPE_uint8_t
+#undef XPACKET_TYPE_uint16_t
+#undef XPACKET_TYPE_uint32_t
+#undef XPACKET_TYPE_uint64_t
+#undef XPACKET_TYPE_int8_t
+#undef XPACKET_TYPE_int16_t
+#undef XPACKET_TYPE_int32_t
+#undef XPACKET_TYPE_int64_t
+#undef XPACKET_TYPE_float
+#undef XPACKET_TYPE_double
 /* undefine overloading macros */
 #undef FIELD
 #undef FIELD_PTR
@@ -0,0 +1,214 @@
+/*
+ * XPacket
+ * Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file xpacket.hpp
+ * \brief C++ frontend of XPacket.
+ * \author Matteo Parolari <mparolari.dev@gmail.com>
+ * \copyright GNU Lesser General Public License version 3.
+ * \version 0.3
+ * \date 02/2018
+ *
+ *    It's included like xpacket.h (that is included by it, with the same
+ *    XPACKET_NAME and XPACKET_STRUCT macros), and it also generates the
+ *    specialization of the xpacket::traits template for the structure.
+ *    For example (C++11 is required):
+ *    \code{.cpp}
+ *    #define XPACKET_NAME msg
+ *    #define XPACKET_STRUCT \
+ *      FIELD(uint16_t, a) \
+ *      FIELD(uint8_t, b, 32)
+ *    #include <xpacket.hpp>
+ *    \endcode
+ *    generates also:
+ *    \code{.cpp}
+ *    namespace xpacket {
+ *    template <> struct traits<msg> {
+ *      typedef msg type;
+ *      typedef XPACKET_SIZE_TYPE size_type;
+ *      static constexpr bool fixed_layout = true;
+ *      static constexpr std::size_t prefix_size = 34;
+ *      static constexpr std::size_t wire_size = 34;
+ *      static constexpr uint32_t schema_id = 0x6e0684b8;
+ *      static constexpr std::size_t offset_a = 0;
+ *      static constexpr std::size_t offset_b = 2;
+ *      static size_type serialize(uint8_t*, const msg&);
+ *      static size_type deserialize(const uint8_t*, msg&);
+ *      static size_type serialize(uint8_t*, size_type, const msg&);
+ *      static size_type deserialize(const uint8_t*, size_type, msg&);
+ *      template <std::size_t N>
+ *      static size_type serialize(std::array<uint8_t, N>&, const msg&);
+ *      template <std::size_t N>
+ *      static size_type deserialize(const std::array<uint8_t, N>&, msg&);
+ *      template <std::size_t E>
+ *      static size_type serialize(std::span<std::byte, E>, const msg&);
+ *      template <std::size_t E>
+ *      static size_type deserialize(std::span<const std::byte, E>, msg&);
+ *    };
+ *    }
+ *    \endcode
+ *    where the offsets (and bit_x for the bit fields) are generated for the
+ *    fields preceding the first variable-size one, prefix_size is the size
+ *    of these fields, and wire_size is WIRE_SIZE, generated only for a
+ *    fixed layout (e.g. 38 with XPACKET_CHECKSUM, for the CRC32C appended
+ *    to the fields). The buffers are always bounds-checked (so, like the
+ *    "_n" functions, they are not supported with FIELD_CUSTOM fields), and
+ *    if their size is known at compile time (std::array, or std::span with
+ *    static extent only if C++20 is used) static_assert checks that it's
+ *    enough for a fixed layout.
+ *
+ *    If XPACKET_C is not defined, the functions are generated static inline
+ *    (so the header can be used alone, and the functions can always be
+ *    inlined); otherwise they are generated as usual.
+ */
+
+/*---------------------------------------------------------------------------*/
+/* included by xpacket.h, with its macros still defined: traits generation */
+#ifdef XPACKET_HPP_EXTENSION
+namespace xpacket {
+template <>
+struct traits<XPACKET_NAME> {
+  typedef XPACKET_NAME type;
+  typedef XPACKET_SIZE_TYPE size_type;
+  /* layout of the serialized packet */
+  static constexpr std::size_t prefix_size =
+    (CONSTANT(XPACKET_NAME, BIT_END_) + 7) / 8;
+  #ifdef XPACKET_FIXED_LAYOUT
+  static constexpr bool fixed_layout = true;
+  static constexpr std::size_t wire_size = CONSTANT(XPACKET_NAME, WIRE_SIZE);
+  #define XPACKET_HPP_MIN_SIZE wire_size
+  #else
+  static constexpr bool fixed_layout = false;
+  #define XPACKET_HPP_MIN_SIZE 0
+  #endif
+  static constexpr uint32_t schema_id = CONSTANT(XPACKET_NAME, SCHEMA_ID);
+  /* offsets of the fields (before the first variable one) */
+  #define FIELD_VAR(type, name) \
+    static constexpr std::size_t offset_##name = \
+      CONSTANT(XPACKET_NAME, OFF_##name);
+  #define FIELD_ARRAY(type, name, dim)      FIELD_VAR(type, name)
+  #define FIELD_PTR_VAR(type, name)         FIELD_VAR(type, name)
+  #define FIELD_PTR_ARRAY(type, name, dim)  FIELD_VAR(type, name)
+  #define FIELD_VARRAY                      FIXED_PREFIX_END
+  #define FIELD_VARINT                      FIXED_PREFIX_END
+  #define FIELD_BITS(type, name, nbits) \
+    FIELD_VAR(type, name) \
+    static constexpr std::size_t bit_##name = \
+      CONSTANT(XPACKET_NAME, BIT_##name);
+  #define FIELD_CUSTOM                      FIXED_PREFIX_END
+  #define FIELD_HOOK                        FIXED_PREFIX_END
+  FIXED_PREFIX
+  #undef FIELD_VAR
+  #undef FIELD_ARRAY
+  #undef FIELD_PTR_VAR
+  #undef FIELD_PTR_ARRAY
+  #undef FIELD_VARRAY
+  #undef FIELD_VARINT
+  #undef FIELD_BITS
+  #undef FIELD_CUSTOM
+  #undef FIELD_HOOK
+  /* (de)serialization of a raw payload */
+  static size_type serialize(std::uint8_t* pl, const type& v) {
+    return ::METHOD(serialize, XPACKET_NAME)(pl, &v);
+  }
+  static size_type deserialize(const std::uint8_t* pl, type& v) {
+    return ::METHOD(deserialize, XPACKET_NAME)(pl, &v);
+  }
+  #ifndef XPACKET_CUSTOM_FIELDS
+  static size_type serialize
+      (std::uint8_t* pl, size_type len, const type& v) {
+    return ::METHOD(serialize_n, XPACKET_NAME)(pl, len, &v);
+  }
+  static size_type deserialize
+      (const std::uint8_t* pl, size_type len, type& v) {
+    return ::METHOD(deserialize_n, XPACKET_NAME)(pl, len, &v);
+  }
+  /* (de)serialization of a buffer of known size */
+  template <std::size_t N>
+  static size_type serialize
+      (std::array<std::uint8_t, N>& buf, const type& v) {
+    static_assert(N >= XPACKET_HPP_MIN_SIZE, "XPacket - small buffer");
+    return serialize(buf.data(), XPACKET_HPP_LEN(N), v);
+  }
+  template <std::size_t N>
+  static size_type deserialize
+      (const std::array<std::uint8_t, N>& buf, type& v) {
+    static_assert(N >= XPACKET_HPP_MIN_SIZE, "XPacket - small buffer");
+    return deserialize(buf.data(), XPACKET_HPP_LEN(N), v);
+  }
+  #ifdef XPACKET_HPP_SPAN
+  template <std::size_t E>
+  static size_type serialize(std::span<std::byte, E> buf, const type& v) {
+    static_assert(E == std::dynamic_extent || E >= XPACKET_HPP_MIN_SIZE,
+      "XPacket - small buffer");
+    return serialize(reinterpret_cast<std::uint8_t*>(buf.data()),
+      XPACKET_HPP_LEN(buf.size()), v);
+  }
+  template <std::size_t E>
+  static size_type deserialize
+      (std::span<const std::byte, E> buf, type& v) {
+    static_assert(E == std::dynamic_extent || E >= XPACKET_HPP_MIN_SIZE,
+      "XPacket - small buffer");
+    return deserialize(reinterpret_cast<const std::uint8_t*>(buf.data()),
+      XPACKET_HPP_LEN(buf.size()), v);
+  }
+  #endif
+  #endif
+  #undef XPACKET_HPP_MIN_SIZE
+};
+}
+/*---------------------------------------------------------------------------*/
+/* included by the user: common definitions and xpacket.h inclusion */
+#else
+#ifndef XPACKET_HPP
+#define XPACKET_HPP
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+#ifdef __cpp_lib_span
+#define XPACKET_HPP_SPAN
+#endif
+/* buffer length, saturated to the maximum payload length */
+#define XPACKET_HPP_LEN(n) static_cast<XPACKET_SIZE_TYPE> \
+  ((n) < XPACKET_SIZE_MAX ? (n) : XPACKET_SIZE_MAX)
+namespace xpacket {
+/* specialized for every packet */
+template <typename T>
+struct traits;
+}
+#endif /* XPACKET_HPP */
+/* functions are static inline if they are not explicitly defined */
+#ifndef XPACKET_C
+#define XPACKET_C
+#define XPACKET_INLINE
+#define XPACKET_HPP_INLINE
+#endif
+#define XPACKET_HPP_EXTENSION
+#define XPACKET_EXTENSION "xpacket.hpp"
+#include "xpacket.h"
+#undef XPACKET_EXTENSION
+#undef XPACKET_HPP_EXTENSION
+#ifdef XPACKET_HPP_INLINE
+#undef XPACKET_C
+#undef XPACKET_INLINE
+#undef XPACKET_HPP_INLINE
+#endif
+#endif /* XPACKET_HPP_EXTENSION */
@@ -0,0 +1,141 @@
+/*
+ * XPacket
+ * Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file xpacket_dispatch.h
+ * \brief Dispatch of the packets of different types sharing a channel.
+ * \author Matteo Parolari <mparolari.dev@gmail.com>
+ * \copyright GNU Lesser General Public License version 3.
+ * \version 0.3
+ * \date 02/2018
+ *
+ *    Every packet is generated with its identifier (XPACKET_ID, from 0 to
+ *    255), and the XPACKET_PACKETS(P) macro lists them (P(name) for every
+ *    packet) before including this header. On the channel a frame is the
+ *    identifier (a byte) followed by the serialized packet. For example:
+ *    \code{.c}
+ *    #define XPACKET_NAME ping
+ *    #define XPACKET_ID 0
+ *    ...
+ *    #include <xpacket.h>
+ *    #define XPACKET_NAME data
+ *    #define XPACKET_ID 1
+ *    ...
+ *    #include <xpacket.h>
+ *    #define XPACKET_PACKETS(P) P(ping) P(data)
+ *    #include <xpacket_dispatch.h>
+ *    // sender
+ *    frame[0] = data_ID;
+ *    n = 1 + serialize_data(frame + 1, &d);
+ *    // receiver
+ *    union xpacket_any any;
+ *    uint8_t id;
+ *    if (xpacket_dispatch(frame, n, &id, &any)) switch (id) { ... }
+ *    \endcode
+ *    The identifiers are switch cases, so the compiler reports the ones
+ *    used twice, and it can compile the dispatch as a single indexed jump
+ *    when they are dense (e.g. 0, 1, 2 ...). The registry xpacket_entries
+ *    (identifier, wire size and deserialize_n of every packet, in the list
+ *    order) can be used for the other lookups.
+ */
+
+#ifndef XPACKET_DISPATCH_H
+#define XPACKET_DISPATCH_H
+#ifndef XPACKET_PACKETS
+#error "XPacket - XPACKET_PACKETS not defined"
+#endif
+#include <stddef.h>
+#include <stdint.h>
+
+/* deserialize_n of a packet, with the structure as a generic pointer */
+typedef XPACKET_SIZE_TYPE (*xpacket_deserialize_any)
+  (const uint8_t*, XPACKET_SIZE_TYPE, void*);
+
+/* entry of the registry */
+struct xpacket_entry {
+  uint8_t id;                           /* identifier (XPACKET_ID) */
+  size_t wire_size;                     /* WIRE_SIZE (0 if variable) */
+  xpacket_deserialize_any deserialize;  /* deserialize_n */
+  const char* name;                     /* XPACKET_NAME */
+};
+
+/* tagged union: the structure of every packet (the tag is the identifier) */
+union xpacket_any {
+  #define XPACKET_ENTRY(name) struct name name;
+  XPACKET_PACKETS(XPACKET_ENTRY)
+  #undef XPACKET_ENTRY
+};
+
+/* registry of the packets, in the list order */
+static const struct xpacket_entry xpacket_entries[] = {
+  #define XPACKET_ENTRY(name) \
+    { name##_ID, name##_FIXED_SIZE, name##_deserialize_any, #name },
+  XPACKET_PACKETS(XPACKET_ENTRY)
+  #undef XPACKET_ENTRY
+};
+
+/* position of every packet in the registry */
+enum {
+  #define XPACKET_ENTRY(name) xpacket_entry_##name,
+  XPACKET_PACKETS(XPACKET_ENTRY)
+  #undef XPACKET_ENTRY
+  XPACKET_ENTRIES
+};
+
+/**
+ * \brief        Find a packet in the registry.
+ * \param id     Identifier of the packet.
+ * \return       Entry of the packet, or NULL if the identifier is unknown.
+ */
+static inline const struct xpacket_entry* xpacket_lookup(uint8_t id) {
+  switch (id) {
+    #define XPACKET_ENTRY(name) \
+      case name##_ID: return &xpacket_entries[xpacket_entry_##name];
+    XPACKET_PACKETS(XPACKET_ENTRY)
+    #undef XPACKET_ENTRY
+    default: return NULL;
+  }
+}
+
+/**
+ * \brief        Deserialize a frame, whatever its packet is.
+ * \param pl     Frame memory address (identifier and serialized packet).
+ * \param len    Frame length (in bytes).
+ * \param id     Where the identifier of the packet is saved.
+ * \param data   Structure of the packet (e.g. a union xpacket_any, with
+ *               the targets of the FIELD_PTR fields, as usual).
+ * \return       Number of bytes deserialized (identifier included), or 0
+ *               if the identifier is unknown, or the packet is truncated.
+ */
+static inline XPACKET_SIZE_TYPE xpacket_dispatch(const uint8_t* pl,
+    XPACKET_SIZE_TYPE len, uint8_t* id, void* data) {
+  XPACKET_SIZE_TYPE n;
+  if (len == 0) return 0;
+  *id = pl[0];
+  /* every case calls the deserialize_n of its packet directly */
+  switch (pl[0]) {
+    #define XPACKET_ENTRY(name) \
+      case name##_ID: n = name##_deserialize_any(pl + 1, len - 1, data); break;
+    XPACKET_PACKETS(XPACKET_ENTRY)
+    #undef XPACKET_ENTRY
+    default: return 0;
+  }
+  return n ? n + 1 : 0;
+}
+
+#endif /* XPACKET_DISPATCH_H */
@@ -0,0 +1,206 @@
+/*
+ * XPacket
+ * Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file xpacket_log.h
+ * \brief Memory-mapped log of fixed-size packets.
+ * \author Matteo Parolari <mparolari.dev@gmail.com>
+ * \copyright GNU Lesser General Public License version 3.
+ * \version 0.3
+ * \date 02/2018
+ *
+ *    A log is a file of serialized packets of the same fixed layout, one
+ *    after the other (so it's simply the payload of serialize_batch_msg):
+ *    it's appended with xpacket_log_create/xpacket_log_append, and read
+ *    back with xpacket_log_open, that maps it in memory. Then the i-th
+ *    record is at xpacket_log_at(&log, i), in constant time and without
+ *    copying anything, and it can be read with the views, deserialized, or
+ *    the whole log can be given to deserialize_batch_msg. For example:
+ *    \code{.c}
+ *    struct xpacket_log log;
+ *    size_t i;
+ *    if (xpacket_log_open(&log, "msg.log", msg_WIRE_SIZE) == 0) {
+ *      for (i = 0; i < log.count; i++)
+ *        sum += msg_get_a(xpacket_log_at(&log, i));
+ *      xpacket_log_close(&log);
+ *    }
+ *    \endcode
+ *    The functions return 0, or -1 setting errno (like the system calls
+ *    they use). The mapping is a snapshot: the records appended after
+ *    xpacket_log_open are not visible (a final incomplete record, e.g.
+ *    after a crash of the writer, is ignored). POSIX is required (mmap,
+ *    ftruncate): the files including the header must be compiled with
+ *    _POSIX_C_SOURCE at least 200809L or an equivalent (e.g. _XOPEN_SOURCE
+ *    700, or the default mode of the compiler, like -std=gnu99), since
+ *    -std=c99 alone hides the POSIX declarations and fires an error.
+ */
+
+#ifndef XPACKET_LOG_H
+#define XPACKET_LOG_H
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+/* the POSIX declarations must be enabled by the includer (see above) */
+#if (defined(__STRICT_ANSI__) || defined(_POSIX_C_SOURCE)) && \
+    !defined(_XOPEN_SOURCE) && \
+    (!defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 200809L)
+#error "XPacket - POSIX is required (e.g. -D_POSIX_C_SOURCE=200809L)"
+#endif
+
+/* a log opened for appending (fd) or reading (mapping) */
+struct xpacket_log {
+  int fd;         /* file descriptor (-1 if the log is only mapped) */
+  uint8_t* base;  /* mapped records (NULL if not mapped, or empty) */
+  size_t size;    /* size of the mapping */
+  size_t record;  /* size of a record (WIRE_SIZE) */
+  size_t count;   /* number of (mapped or appended) records */
+};
+
+/**
+ * \brief        Create a log, or open it for appending.
+ * \param log    Log.
+ * \param path   File path (created if it does not exist).
+ * \param record Size of a record.
+ * \return       0, or -1 if it fails (errno is set).
+ *
+ *    If the file ends with an incomplete record (e.g. after a crash of the
+ *    writer), it's truncated before appending.
+ */
+static inline int xpacket_log_create
+    (struct xpacket_log* log, const char* path, size_t record) {
+  struct stat st;
+  log->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (log->fd < 0) return -1;
+  /* a final incomplete record is removed, so the next ones are aligned */
+  if (fstat(log->fd, &st) != 0 ||
+      ftruncate(log->fd, st.st_size - st.st_size % (off_t)record) != 0) {
+    close(log->fd);
+    return -1;
+  }
+  log->base = NULL;
+  log->size = 0;
+  log->record = record;
+  log->count = (size_t)st.st_size / record;
+  return 0;
+}
+
+/**
+ * \brief        Append records to a log.
+ * \param log    Log (created by xpacket_log_create).
+ * \param rec    Serialized records (e.g. by serialize_batch_msg).
+ * \param n      Number of records.
+ * \return       0, or -1 if it fails (errno is set).
+ *
+ *    The records are written with a single system call (unless it's
+ *    interrupted), so appending a batch is cheaper than every record. If
+ *    it fails after a partial write, the file is truncated back to the
+ *    previous records, so none of the batch is appended.
+ */
+static inline int xpacket_log_append
+    (struct xpacket_log* log, const void* rec, size_t n) {
+  const uint8_t* p = (const uint8_t*)rec;
+  size_t len = n * log->record;
+  while (len > 0) {
+    ssize_t w = write(log->fd, p, len);
+    if (w < 0) {
+      int e = errno;
+      if (e == EINTR) continue;
+      /* the error of write is kept, even if ftruncate fails too */
+      if (p != (const uint8_t*)rec)
+        (void)ftruncate(log->fd, (off_t)(log->count * log->record));
+      errno = e;
+      return -1;
+    }
+    p += w;
+    len -= (size_t)w;
+  }
+  log->count += n;
+  return 0;
+}
+
+/**
+ * \brief        Open a log for reading, mapping it in memory.
+ * \param log    Log.
+ * \param path   File path.
+ * \param record Size of a record.
+ * \return       0, or -1 if it fails (errno is set).
+ */
+static inline int xpacket_log_open
+    (struct xpacket_log* log, const char* path, size_t record) {
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return -1;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return -1;
+  }
+  log->fd = -1;
+  log->base = NULL;
+  log->record = record;
+  log->count = (size_t)st.st_size / record;
+  log->size = log->count * record;
+  /* an empty file can not be mapped */
+  if (log->size > 0) {
+    void* m = mmap(NULL, log->size, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+      close(fd);
+      return -1;
+    }
+    log->base = (uint8_t*)m;
+    /* a replay reads all the records: they can be read ahead */
+    #ifdef POSIX_MADV_WILLNEED
+    posix_madvise(m, log->size, POSIX_MADV_WILLNEED);
+    #endif
+  }
+  /* the mapping is still valid after closing the file */
+  close(fd);
+  return 0;
+}
+
+/**
+ * \brief        Address of a record of a mapped log.
+ * \param log    Log (opened by xpacket_log_open).
+ * \param i      Index of the record (less than log->count).
+ * \return       Address of the serialized record.
+ */
+static inline const uint8_t* xpacket_log_at
+    (const struct xpacket_log* log, size_t i) {
+  return log->base + i * log->record;
+}
+
+/**
+ * \brief        Close a log (unmap it, or close its file).
+ * \param log    Log.
+ * \return       0, or -1 if it fails (errno is set).
+ */
+static inline int xpacket_log_close(struct xpacket_log* log) {
+  int r = 0;
+  if (log->base && munmap(log->base, log->size) != 0) r = -1;
+  if (log->fd >= 0 && close(log->fd) != 0) r = -1;
+  log->fd = -1;
+  log->base = NULL;
+  log->size = 0;
+  log->count = 0;
+  return r;
+}
+
+#endif /* XPACKET_LOG_H */
@@ -0,0 +1,180 @@
+/*
+ * XPacket
+ * Copyright (C) 2017-18 Matteo Parolari <mparolari.dev@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file xpacket_ring.h
+ * \brief Lock-free ring buffer of fixed-size packets.
+ * \author Matteo Parolari <mparolari.dev@gmail.com>
+ * \copyright GNU Lesser General Public License version 3.
+ * \version 0.3
+ * \date 02/2018
+ *
+ *    A ring of slots of WIRE_SIZE bytes, where many producer threads
+ *    serialize the packets directly, and a single consumer thread drains
+ *    them (e.g. on a socket) in contiguous runs, without locks and without
+ *    other copies. For example:
+ *    \code{.c}
+ *    static uint8_t data[1024 * msg_WIRE_SIZE];
+ *    static size_t seq[1024];
+ *    struct xpacket_ring ring;
+ *    xpacket_ring_init(&ring, data, seq, 1024, msg_WIRE_SIZE);
+ *    // producers
+ *    size_t t;
+ *    uint8_t* slot = xpacket_ring_reserve(&ring, &t);
+ *    if (slot) {
+ *      serialize_msg(slot, &m);
+ *      xpacket_ring_commit(&ring, t);
+ *    }
+ *    // consumer
+ *    size_t n;
+ *    const uint8_t* run = xpacket_ring_peek(&ring, &n);
+ *    if (n > 0) {
+ *      send(fd, run, n * msg_WIRE_SIZE, 0);
+ *      xpacket_ring_release(&ring, n);
+ *    }
+ *    \endcode
+ *    Every slot has a sequence number, that tells if it's free, reserved
+ *    or committed in the current lap of the ring: the producers reserve
+ *    the slots in order with a compare-and-swap, and can commit them in
+ *    any order, while the consumer sees only the committed slots that
+ *    follow the ones already consumed (a run ends at the first slot not yet
+ *    committed, or at the end of the memory). With a single producer, the
+ *    compare-and-swap never fails. The __atomic builtins of GCC and Clang
+ *    are required.
+ */
+
+#ifndef XPACKET_RING_H
+#define XPACKET_RING_H
+#include <stddef.h>
+#include <stdint.h>
+
+/* size of a cache line, to keep producers and consumer on different ones */
+#ifndef XPACKET_RING_LINE
+#define XPACKET_RING_LINE 64
+#endif
+
+/* ring of "mask + 1" slots of "record" bytes */
+struct xpacket_ring {
+  uint8_t* data;  /* memory of the slots */
+  size_t* seq;    /* sequence number of every slot */
+  size_t record;  /* size of a slot (WIRE_SIZE) */
+  size_t mask;    /* number of slots - 1 */
+  uint8_t pad0[XPACKET_RING_LINE];
+  size_t head;    /* next slot to reserve (shared by the producers) */
+  uint8_t pad1[XPACKET_RING_LINE];
+  size_t tail;    /* next slot to consume (owned by the consumer) */
+};
+
+/**
+ * \brief        Initialize a ring.
+ * \param ring   Ring.
+ * \param data   Memory of the slots (capacity * record bytes).
+ * \param seq    Array of capacity sequence numbers.
+ * \param cap    Number of slots (power of 2).
+ * \param record Size of a slot.
+ * \return       0, or -1 if the capacity is not a power of 2.
+ */
+static inline int xpacket_ring_init(struct xpacket_ring* ring, uint8_t* data,
+    size_t* seq, size_t cap, size_t record) {
+  size_t i;
+  if (cap == 0 || (cap & (cap - 1))) return -1;
+  ring->data = data;
+  ring->seq = seq;
+  ring->record = record;
+  ring->mask = cap - 1;
+  ring->head = 0;
+  ring->tail = 0;
+  /* the slot i is free for the ticket i */
+  for (i = 0; i < cap; i++) seq[i] = i;
+  return 0;
+}
+
+/**
+ * \brief        Reserve the next slot (producers).
+ * \param ring   Ring.
+ * \param ticket Where the ticket of the slot is saved (for the commit).
+ * \return       Memory of the slot, or NULL if the ring is full.
+ */
+static inline uint8_t* xpacket_ring_reserve
+    (struct xpacket_ring* ring, size_t* ticket) {
+  size_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+  for (;;) {
+    size_t seq = __atomic_load_n(&ring->seq[pos & ring->mask],
+      __ATOMIC_ACQUIRE);
+    intptr_t diff = (intptr_t)(seq - pos);
+    if (diff == 0) {
+      /* free: take it, unless another producer did it first */
+      if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1,
+          __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+    else if (diff < 0) return NULL; /* not yet consumed in the last lap */
+    else pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+  }
+  *ticket = pos;
+  return ring->data + (pos & ring->mask) * ring->record;
+}
+
+/**
+ * \brief        Commit a reserved slot, making it visible to the consumer.
+ * \param ring   Ring.
+ * \param ticket Ticket of the slot (from xpacket_ring_reserve).
+ */
+static inline void xpacket_ring_commit(struct xpacket_ring* ring,
+    size_t ticket) {
+  __atomic_store_n(&ring->seq[ticket & ring->mask], ticket + 1,
+    __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief        Get the next run of committed slots (consumer).
+ * \param ring   Ring.
+ * \param n      Where the number of slots of the run is saved (0 if the
+ *               ring is empty).
+ * \return       Memory of the first slot of the run.
+ *
+ *    The slots are contiguous in memory, so the run can be used as a
+ *    whole (e.g. by deserialize_batch_msg, or a single send).
+ */
+static inline const uint8_t* xpacket_ring_peek
+    (struct xpacket_ring* ring, size_t* n) {
+  size_t first = ring->tail & ring->mask;
+  size_t i = 0;
+  /* stop at the first slot not committed, or at the end of the memory */
+  while (first + i <= ring->mask &&
+      __atomic_load_n(&ring->seq[first + i], __ATOMIC_ACQUIRE) ==
+        ring->tail + i + 1) i++;
+  *n = i;
+  return ring->data + first * ring->record;
+}
+
+/**
+ * \brief        Release consumed slots, making them free for the producers.
+ * \param ring   Ring.
+ * \param n      Number of slots (at most the ones of the last run).
+ */
+static inline void xpacket_ring_release(struct xpacket_ring* ring,
+    size_t n) {
+  size_t i;
+  /* the slot of the ticket t is free again for the ticket t + capacity */
+  for (i = 0; i < n; i++)
+    __atomic_store_n(&ring->seq[(ring->tail + i) & ring->mask],
+      ring->tail + i + ring->mask + 1, __ATOMIC_RELEASE);
+  ring->tail += n;
+}
+
+#endif /* XPACKET_RING_H */